@@ -0,0 +1,192 @@
+/* Times the capture, split and render steps a check goes through on
+ * synthetic backend output of 0 to 50k lines, next to the code they
+ * replaced: fgets() into a string, split() through an istringstream and a
+ * stringstream body. Also compares popen() with CliWrapper's own spawn.
+ *
+ * Usage: aarchup_bench [rounds] [max entries]
+ *
+ * The outputs are written to files in $TMPDIR (or /tmp), read back
+ * through a file descriptor for the in-process cases and with cat for the
+ * spawn cases, and removed afterwards. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CliWrapper.hh"
+#include "LineBuffer.hh"
+#include "LineSplitter.hh"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+namespace legacy {
+
+/* What aarchup did before CliWrapper grew its own reader and splitter. */
+string parseOutput(const shared_ptr<FILE> &pipe) {
+  array<char, 128> buffer = {0};
+  string result;
+  while (!feof(pipe.get())) {
+    if (fgets(buffer.data(), 128, pipe.get()) != nullptr) {
+      result += buffer.data();
+    }
+  }
+  return result;
+}
+
+vector<string> split(const string &s, char delimiter) {
+  vector<string> tokens;
+  string token;
+  istringstream tokenStream(s);
+  while (getline(tokenStream, token, delimiter)) {
+    tokens.push_back(token);
+  }
+  return tokens;
+}
+
+string body(const string &output, long maxEntries) {
+  auto outputLines = split(output, '\n');
+  long lines = 0;
+  stringstream ss;
+  for (auto &outputLine : outputLines) {
+    ss << outputLine << '\n';
+    lines++;
+    if (lines >= maxEntries) {
+      break;
+    }
+  }
+  return ss.str();
+}
+
+}  // namespace legacy
+
+static string makeOutput(long lines) {
+  string output;
+  for (long i = 0; i < lines; ++i) {
+    output += "package" + to_string(i) + ' ' + to_string(i % 17) + '.' +
+              to_string(i % 5) + "-1 -> " + to_string(i % 17) + '.' +
+              to_string(i % 5 + 1) + "-1\n";
+  }
+  return output;
+}
+
+/* Average microseconds per call of f over rounds calls. */
+template <class F>
+static double usPer(int rounds, F f) {
+  const auto start = Clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    f();
+  }
+  const auto elapsed = Clock::now() - start;
+  return chrono::duration<double, micro>(elapsed).count() / rounds;
+}
+
+static void report(const char *what, long lines, double us) {
+  cout << left << setw(28) << what << right << setw(7) << lines << " lines "
+       << fixed << setprecision(1) << setw(10) << us << " us\n";
+}
+
+int main(int argc, char **argv) {
+  const int rounds = argc > 1 ? atoi(argv[1]) : 20;
+  const long maxEntries = argc > 2 ? atol(argv[2]) : 30;
+  const char *tmp = getenv("TMPDIR");
+  const string dir = tmp ? tmp : "/tmp";
+  const long sizes[] = {0, 10, 100, 1000, 10000, 50000};
+  size_t sink = 0;
+
+  for (const long lines : sizes) {
+    const string output = makeOutput(lines);
+    string path = dir + "/aarchup-bench-XXXXXX";
+    const int fd = mkstemp(&path[0]);
+    if (fd < 0) {
+      cerr << "Can't create a file in " << dir << '\n';
+      return 2;
+    }
+    ofstream(path) << output;
+
+    /* Capture: bytes from a descriptor into memory. */
+    report("fgets parseOutput", lines, usPer(rounds, [&]() {
+             shared_ptr<FILE> file(fopen(path.c_str(), "r"), fclose);
+             sink += legacy::parseOutput(file).size();
+           }));
+    report("CliWrapper::parseOutput", lines, usPer(rounds, [&]() {
+             string result;
+             lseek(fd, 0, SEEK_SET);
+             CliWrapper::parseOutput(fd, result, CliWrapper::DEFAULT_MAX_OUTPUT);
+             sink += result.size();
+           }));
+
+    /* Split: every line, as the old code always did. */
+    report("split()", lines, usPer(rounds, [&]() {
+             sink += legacy::split(output, '\n').size();
+           }));
+    report("LineSplitter", lines, usPer(rounds, [&]() {
+             LineSplitter splitter([&](string_view line) {
+               sink += line.size();
+               return true;
+             });
+             splitter.feed(output.data(), output.size());
+             splitter.finish();
+           }));
+
+    /* Render: the notification body of maxEntries lines. */
+    report("split() + stringstream body", lines, usPer(rounds, [&]() {
+             sink += legacy::body(output, maxEntries).size();
+           }));
+    report("LineBuffer body", lines, usPer(rounds, [&]() {
+             LineBuffer body(maxEntries);
+             LineSplitter splitter(
+                 [&body](string_view line) { return body.addLine(line); });
+             splitter.feed(output.data(), output.size());
+             splitter.finish();
+             sink += body.str().size();
+           }));
+    report("streamOutput + LineBuffer", lines, usPer(rounds, [&]() {
+             LineBuffer body(maxEntries);
+             LineSplitter splitter(
+                 [&body](string_view line) { return body.addLine(line); });
+             size_t bytesRead = 0;
+             lseek(fd, 0, SEEK_SET);
+             CliWrapper::streamOutput(fd, splitter,
+                                      CliWrapper::DEFAULT_MAX_OUTPUT, bytesRead);
+             splitter.finish();
+             sink += body.str().size();
+           }));
+
+    /* Spawn: a whole backend run, process included. */
+    const string command = "/bin/cat " + path;
+    report("popen + fgets", lines, usPer(rounds, [&]() {
+             shared_ptr<FILE> pipe(popen(command.c_str(), "r"), pclose);
+             sink += legacy::parseOutput(pipe).size();
+           }));
+    report("CliWrapper pipe", lines, usPer(rounds, [&]() {
+             CliWrapper cat(command.c_str());
+             sink += cat.execute().output.size();
+           }));
+    report("CliWrapper memfd", lines, usPer(rounds, [&]() {
+             CliWrapper cat(command.c_str());
+             cat.setUseMemfd(true);
+             sink += cat.execute().output.size();
+           }));
+    report("CliWrapper streamed body", lines, usPer(rounds, [&]() {
+             LineBuffer body(maxEntries);
+             CliWrapper cat(command.c_str());
+             cat.execute([&body](string_view line) { return body.addLine(line); });
+             sink += body.str().size();
+           }));
+    cout << '\n';
+
+    close(fd);
+    unlink(path.c_str());
+  }
+  cout << "checksum " << sink << '\n';
+  return 0;
+}
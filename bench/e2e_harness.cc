@@ -0,0 +1,433 @@
+/* Runs the real aarchup against fake_backend.sh and a stand-in
+ * org.freedesktop.Notifications served from this process on a private
+ * dbus-daemon, and reports the timeline of every check: when the backend
+ * was spawned, wrote its first and last byte, when Notify reached the
+ * server and when aarchup had the reply (it answered a ping sent right
+ * behind it). Times are milliseconds since the check was triggered.
+ *
+ * Usage: aarchup_e2e [options] [-- aarchup options]
+ *   --aarchup path       binary under test (default: the one built here)
+ *   --backend args       fake_backend.sh options (default "--lines 100")
+ *   --cycles n           checks to time (default 10)
+ *   --reply-delay ms     hold every Notify reply back this long
+ *   --oneshot            start aarchup for every check instead of sending
+ *                        SIGHUP to one looping instance
+ *   --dbus-daemon path   default dbus-daemon from $PATH
+ *   --timeout s          give up on a check after this long (default 10)
+ *   --allocations        also report aarchup_check_heap_allocations from a
+ *                        --metrics-file, and fail if any check from the
+ *                        third on allocated; needs a looping aarchup built
+ *                        with -DAARCHUP_COUNT_ALLOCATIONS=ON
+ *
+ * Everything lives in a fresh directory below $TMPDIR (or /tmp) that is
+ * removed afterwards; the user's session bus and state are not touched. */
+#include <errno.h>
+#include <ftw.h>
+#include <getopt.h>
+#include <gio/gio.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern char **environ;
+
+using namespace std;
+
+namespace {
+
+const char *const INTROSPECTION =
+    "<node><interface name='org.freedesktop.Notifications'>"
+    "<method name='Notify'><arg type='s' direction='in'/>"
+    "<arg type='u' direction='in'/><arg type='s' direction='in'/>"
+    "<arg type='s' direction='in'/><arg type='s' direction='in'/>"
+    "<arg type='as' direction='in'/><arg type='a{sv}' direction='in'/>"
+    "<arg type='i' direction='in'/><arg type='u' direction='out'/></method>"
+    "<method name='CloseNotification'><arg type='u' direction='in'/></method>"
+    "<signal name='NotificationClosed'><arg type='u'/><arg type='u'/></signal>"
+    "</interface></node>";
+
+enum Mark { SPAWN, FIRST, LAST, CALL, REPLY, MARKS };
+const char *const MARK_NAMES[MARKS] = {"spawn", "first", "last", "call",
+                                       "reply"};
+
+long long nowNs() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct Harness {
+  unsigned replyDelay = 0;
+  bool nameOwned = false;
+  uint32_t nextId = 1;
+  /* Of the running cycle, 0 while not seen yet. */
+  long long marks[MARKS] = {};
+};
+
+struct DelayedReply {
+  GDBusMethodInvocation *invocation;
+  uint32_t id;
+  Harness *h;
+};
+
+/* The bus keeps the order of our messages to aarchup, and its connection
+ * answers Peer.Ping itself, so the pong means aarchup has the reply. An
+ * error means it left, which a one-shot aarchup may do just as quickly. */
+void onPong(GObject *bus, GAsyncResult *result, gpointer data) {
+  Harness &h = *static_cast<Harness *>(data);
+  GError *error = nullptr;
+  GVariant *pong =
+      g_dbus_connection_call_finish(G_DBUS_CONNECTION(bus), result, &error);
+  if (pong) {
+    g_variant_unref(pong);
+  } else {
+    g_error_free(error);
+  }
+  if (!h.marks[REPLY]) {
+    h.marks[REPLY] = nowNs();
+  }
+}
+
+gboolean sendReply(gpointer data) {
+  DelayedReply *reply = static_cast<DelayedReply *>(data);
+  GDBusConnection *bus =
+      g_dbus_method_invocation_get_connection(reply->invocation);
+  const string sender = g_dbus_method_invocation_get_sender(reply->invocation);
+  g_dbus_method_invocation_return_value(reply->invocation,
+                                        g_variant_new("(u)", reply->id));
+  g_dbus_connection_call(bus, sender.c_str(), "/", "org.freedesktop.DBus.Peer",
+                         "Ping", nullptr, nullptr, G_DBUS_CALL_FLAGS_NONE, -1,
+                         nullptr, onPong, reply->h);
+  delete reply;
+  return G_SOURCE_REMOVE;
+}
+
+void onMethodCall(GDBusConnection *, const gchar *, const gchar *,
+                  const gchar *, const gchar *method, GVariant *parameters,
+                  GDBusMethodInvocation *invocation, gpointer data) {
+  Harness &h = *static_cast<Harness *>(data);
+  if (strcmp(method, "Notify") != 0) {
+    g_dbus_method_invocation_return_value(invocation, nullptr);
+    return;
+  }
+  h.marks[CALL] = nowNs();
+  guint32 replacesId = 0;
+  g_variant_get_child(parameters, 1, "u", &replacesId);
+  DelayedReply *reply =
+      new DelayedReply{invocation, replacesId ? replacesId : h.nextId++, &h};
+  if (h.replyDelay) {
+    g_timeout_add(h.replyDelay, sendReply, reply);
+  } else {
+    sendReply(reply);
+  }
+}
+
+void onNameAcquired(GDBusConnection *, const gchar *, gpointer data) {
+  static_cast<Harness *>(data)->nameOwned = true;
+}
+
+pid_t spawn(const vector<string> &args) {
+  vector<char *> argv;
+  for (const auto &arg : args) {
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+  pid_t pid;
+  const int err = posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(),
+                               environ);
+  if (err != 0) {
+    cerr << "Can't start " << args[0] << ": " << strerror(err) << '\n';
+    return -1;
+  }
+  return pid;
+}
+
+void stop(pid_t pid) {
+  if (pid > 0) {
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+  }
+}
+
+/* Runs the default context until done() or the deadline. */
+template <class Done>
+bool iterateUntil(Done done, long long deadline) {
+  /* Wakes the loop up now and then to look at the clock. */
+  const guint tick =
+      g_timeout_add(10, [](gpointer) { return G_SOURCE_CONTINUE; }, nullptr);
+  bool finished;
+  while (!(finished = done()) && nowNs() < deadline) {
+    g_main_context_iteration(nullptr, TRUE);
+  }
+  g_source_remove(tick);
+  return finished;
+}
+
+void readTrace(const string &path, long long marks[MARKS]) {
+  ifstream in(path);
+  string name;
+  long long ns;
+  while (in >> name >> ns) {
+    for (int m = SPAWN; m <= LAST; ++m) {
+      if (name == MARK_NAMES[m]) {
+        marks[m] = ns;
+      }
+    }
+  }
+}
+
+/* The value of a metric, labels included in name, -1 if it is not there. */
+long long readMetric(const string &path, const string &name) {
+  ifstream in(path);
+  string line;
+  while (getline(in, line)) {
+    if (line.compare(0, name.size() + 1, name + ' ') == 0) {
+      return atoll(line.c_str() + name.size() + 1);
+    }
+  }
+  return -1;
+}
+
+int removeEntry(const char *path, const struct stat *, int, FTW *) {
+  return remove(path);
+}
+
+string formatMs(double ms) {
+  if (ms < 0) {
+    return "-";
+  }
+  ostringstream ss;
+  ss << fixed << setprecision(2) << ms;
+  return ss.str();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Harness h;
+  string aarchup = AARCHUP_BINARY;
+  string backendArgs = "--lines 100";
+  string dbusDaemon = "dbus-daemon";
+  long cycles = 10;
+  long timeout = 10;
+  bool oneshot = false;
+  bool allocations = false;
+
+  enum { OPT_AARCHUP = 256, OPT_BACKEND, OPT_CYCLES, OPT_REPLY_DELAY,
+         OPT_ONESHOT, OPT_DBUS_DAEMON, OPT_TIMEOUT, OPT_ALLOCATIONS };
+  const option long_opts[] = {
+      {"aarchup", required_argument, nullptr, OPT_AARCHUP},
+      {"backend", required_argument, nullptr, OPT_BACKEND},
+      {"cycles", required_argument, nullptr, OPT_CYCLES},
+      {"reply-delay", required_argument, nullptr, OPT_REPLY_DELAY},
+      {"oneshot", no_argument, nullptr, OPT_ONESHOT},
+      {"dbus-daemon", required_argument, nullptr, OPT_DBUS_DAEMON},
+      {"timeout", required_argument, nullptr, OPT_TIMEOUT},
+      {"allocations", no_argument, nullptr, OPT_ALLOCATIONS},
+      {nullptr, 0, nullptr, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "", long_opts, nullptr)) != -1) {
+    switch (opt) {
+      case OPT_AARCHUP: aarchup = optarg; break;
+      case OPT_BACKEND: backendArgs = optarg; break;
+      case OPT_CYCLES: cycles = atol(optarg); break;
+      case OPT_REPLY_DELAY: h.replyDelay = static_cast<unsigned>(atol(optarg)); break;
+      case OPT_ONESHOT: oneshot = true; break;
+      case OPT_DBUS_DAEMON: dbusDaemon = optarg; break;
+      case OPT_TIMEOUT: timeout = atol(optarg); break;
+      case OPT_ALLOCATIONS: allocations = true; break;
+      default: return 2;
+    }
+  }
+  vector<string> extraArgs(argv + optind, argv + argc);
+  if (allocations && oneshot) {
+    /* Every one-shot check is a first check. */
+    cerr << "--allocations needs the looping aarchup, not --oneshot\n";
+    return 2;
+  }
+
+  const char *tmp = getenv("TMPDIR");
+  string work = string(tmp ? tmp : "/tmp") + "/aarchup-e2e-XXXXXX";
+  if (!mkdtemp(&work[0])) {
+    cerr << "Can't create a directory for the run\n";
+    return 2;
+  }
+  const string busPath = work + "/bus";
+  const string tracePath = work + "/trace";
+  const string metricsPath = work + "/metrics.prom";
+  const string stateDir = work + "/state/aarchup";
+  mkdir((work + "/state").c_str(), 0700);
+  mkdir(stateDir.c_str(), 0700);
+  setenv("DBUS_SESSION_BUS_ADDRESS", ("unix:path=" + busPath).c_str(), 1);
+  setenv("XDG_STATE_HOME", (work + "/state").c_str(), 1);
+  setenv("XDG_CACHE_HOME", (work + "/cache").c_str(), 1);
+  setenv("AARCHUP_E2E_TRACE", tracePath.c_str(), 1);
+
+  int status = 1;
+  pid_t daemon = spawn({dbusDaemon, "--session", "--nofork",
+                        "--address=unix:path=" + busPath});
+  pid_t app = -1;
+  GDBusConnection *bus = nullptr;
+  vector<vector<double>> rows;
+  do {
+    if (daemon < 0) {
+      break;
+    }
+    struct stat st;
+    const long long busDeadline = nowNs() + 5000000000LL;
+    while (stat(busPath.c_str(), &st) != 0 && nowNs() < busDeadline) {
+      usleep(5000);
+    }
+    GError *error = nullptr;
+    bus = g_bus_get_sync(G_BUS_TYPE_SESSION, nullptr, &error);
+    if (!bus) {
+      cerr << "Can't connect to the private bus: " << error->message << '\n';
+      g_error_free(error);
+      break;
+    }
+    GDBusNodeInfo *node = g_dbus_node_info_new_for_xml(INTROSPECTION, nullptr);
+    static const GDBusInterfaceVTable vtable = {onMethodCall, nullptr, nullptr, {}};
+    g_dbus_connection_register_object(bus, "/org/freedesktop/Notifications",
+                                      node->interfaces[0], &vtable, &h,
+                                      nullptr, nullptr);
+    g_dbus_node_info_unref(node);
+    g_bus_own_name_on_connection(bus, "org.freedesktop.Notifications",
+                                 G_BUS_NAME_OWNER_FLAGS_NONE, onNameAcquired,
+                                 nullptr, &h, nullptr);
+    if (!iterateUntil([&h]() { return h.nameOwned; }, nowNs() + 5000000000LL)) {
+      cerr << "Can't own org.freedesktop.Notifications\n";
+      break;
+    }
+
+    cout << setw(22) << left
+         << (oneshot ? "cycle (one-shot), ms" : "cycle (SIGHUP), ms") << right;
+    for (const char *name : MARK_NAMES) {
+      cout << setw(9) << name;
+    }
+    if (allocations) {
+      cout << setw(9) << "allocs";
+    }
+    cout << '\n';
+    long timedOut = 0;
+    long allocating = 0;
+    for (long cycle = 0; cycle < cycles; ++cycle) {
+      unlink(tracePath.c_str());
+      fill(h.marks, h.marks + MARKS, 0);
+      /* A new seed each run, so a one-shot aarchup sees new updates. */
+      vector<string> args = {aarchup, "--command",
+                             string(AARCHUP_FAKE_BACKEND) + " " + backendArgs +
+                                 " --seed " + to_string(cycle)};
+      if (!oneshot) {
+        args.insert(args.end(), {"--loop-time", "600"});
+      }
+      if (allocations) {
+        args.insert(args.end(), {"--metrics-file", metricsPath});
+      }
+      args.insert(args.end(), extraArgs.begin(), extraArgs.end());
+
+      const long long start = nowNs();
+      if (oneshot || cycle == 0) {
+        app = spawn(args);
+        if (app < 0) {
+          break;
+        }
+      } else {
+        kill(app, SIGHUP);
+      }
+      const bool done = iterateUntil([&h]() { return h.marks[REPLY] != 0; },
+                                     start + timeout * 1000000000LL);
+      if (oneshot) {
+        waitpid(app, nullptr, 0);
+        app = -1;
+      }
+      readTrace(tracePath, h.marks);
+
+      vector<double> row;
+      cout << setw(5) << cycle << setw(17) << ' ';
+      for (long long mark : h.marks) {
+        row.push_back(mark ? static_cast<double>(mark - start) / 1e6 : -1);
+        cout << setw(9) << formatMs(row.back());
+      }
+      if (allocations) {
+        /* The metrics are written once the Notify call is out and again
+         * once aarchup has handled the reply, both maybe after the pong.
+         * Wait for the second, or its allocations land in the next check. */
+        long long count = -1;
+        iterateUntil(
+            [&]() {
+              if (readMetric(metricsPath, "aarchup_checks_total") < cycle + 1 ||
+                  readMetric(metricsPath,
+                             "aarchup_notifications_total{result=\"shown\"}") <
+                      cycle + 1) {
+                return false;
+              }
+              count = readMetric(metricsPath, "aarchup_check_heap_allocations");
+              return true;
+            },
+            nowNs() + timeout * 1000000000LL);
+        cout << setw(9) << (count >= 0 ? to_string(count) : "-");
+        if (cycle >= 2 && count != 0) {
+          ++allocating;
+        }
+      }
+      if (!done) {
+        ++timedOut;
+        cout << "  (timed out)";
+      }
+      cout << '\n';
+      rows.push_back(row);
+    }
+
+    if (!rows.empty()) {
+      const char *const summaries[] = {"min", "median", "max"};
+      for (int which = 0; which < 3; ++which) {
+        cout << setw(22) << left << summaries[which] << right;
+        for (int m = 0; m < MARKS; ++m) {
+          vector<double> values;
+          for (const auto &row : rows) {
+            if (row[m] >= 0) {
+              values.push_back(row[m]);
+            }
+          }
+          sort(values.begin(), values.end());
+          double value = -1;
+          if (!values.empty()) {
+            const size_t index[] = {0, values.size() / 2, values.size() - 1};
+            value = values[index[which]];
+          }
+          cout << setw(9) << formatMs(value);
+        }
+        cout << '\n';
+      }
+    }
+    if (allocating) {
+      cout << allocating << " check(s) from the third on allocated, or "
+           << "reported no count\n";
+    }
+    status = rows.size() == static_cast<size_t>(cycles) && !timedOut &&
+                     !allocating
+                 ? 0
+                 : 1;
+  } while (false);
+
+  stop(app);
+  if (bus) {
+    g_object_unref(bus);
+  }
+  stop(daemon);
+  nftw(work.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+  return status;
+}
@@ -0,0 +1,58 @@
+#!/bin/bash
+# Stand-in for checkupdates in the end-to-end harness. Prints "name old ->
+# new" lines like the real backends and, when AARCHUP_E2E_TRACE names a
+# file, appends when it started, wrote its first byte and its last byte
+# (nanoseconds since the epoch).
+#
+# Usage: fake_backend.sh [--delay ms] [--lines n] [--exit code] [--hang]
+#                        [--seed s]
+#   --delay  wait this long before the first byte (default 0)
+#   --lines  number of update lines (default 10)
+#   --exit   exit status (default 0)
+#   --hang   never finish after the output, to exercise --command-timeout
+#   --seed   varies the versions, so a timer run sees new updates
+
+now() {
+	local t=${EPOCHREALTIME/./}
+	echo "${t}000"
+}
+
+trace() {
+	if [ -n "$AARCHUP_E2E_TRACE" ]; then
+		echo "$1 $2" >> "$AARCHUP_E2E_TRACE"
+	fi
+}
+
+trace spawn "$(now)"
+delay=0
+lines=10
+status=0
+hang=0
+seed=0
+while [ $# -gt 0 ]; do
+	case "$1" in
+		--delay) delay=$2; shift ;;
+		--lines) lines=$2; shift ;;
+		--exit) status=$2; shift ;;
+		--hang) hang=1 ;;
+		--seed) seed=$2; shift ;;
+		*) echo "unknown option $1" >&2; exit 2 ;;
+	esac
+	shift
+done
+
+if [ "$delay" -gt 0 ]; then
+	sleep "$(printf '%d.%03d' $((delay / 1000)) $((delay % 1000)))"
+fi
+if [ "$lines" -gt 0 ]; then
+	trace first "$(now)"
+	awk -v n="$lines" -v s="$seed" 'BEGIN {
+		for (i = 0; i < n; i++)
+			printf "package%d %d.%d-1 -> %d.%d-1\n", i, i % 17, i % 5, i % 17, i % 5 + 1 + s
+	}'
+	trace last "$(now)"
+fi
+if [ "$hang" -eq 1 ]; then
+	exec sleep infinity
+fi
+exit "$status"
@@ -0,0 +1,114 @@
+/* Times loading a synthetic local database with io_uring and with plain
+ * pread, from a cold and from a warm page cache.
+ *
+ * Usage: aarchup_localdb_bench [parent dir] [packages] [rounds]
+ *
+ * The database is created in a fresh directory below parent dir (default
+ * $TMPDIR or /tmp) and removed afterwards. Cold runs evict the desc files
+ * with POSIX_FADV_DONTNEED, which needs no privileges but has no effect on
+ * tmpfs, so point parent dir at a real disk for meaningful cold numbers. */
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BatchReader.hh"
+#include "LocalDb.hh"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+static vector<string> makeDatabase(const string &dir, long packages) {
+  vector<string> descs;
+  for (long i = 0; i < packages; ++i) {
+    const string name = "package" + to_string(i);
+    const string version = to_string(i % 17) + "." + to_string(i % 5) + "-1";
+    const string pkgDir = dir + "/" + name + "-" + version;
+    mkdir(pkgDir.c_str(), 0755);
+    descs.push_back(pkgDir + "/desc");
+    ofstream desc(descs.back());
+    desc << "%NAME%\n" << name << "\n\n%VERSION%\n" << version << "\n\n"
+         << "%BASE%\n" << name << "\n\n%DESC%\nA synthetic package used to "
+         << "benchmark the local database loader\n\n%URL%\nhttps://example.org/"
+         << name << "\n\n%ARCH%\nx86_64\n\n%BUILDDATE%\n1700000000\n\n"
+         << "%INSTALLDATE%\n1700000100\n\n%PACKAGER%\nBench <bench@example.org>"
+         << "\n\n%SIZE%\n" << i * 1024 << "\n\n%LICENSE%\nGPL3\n\n%VALIDATION%"
+         << "\npgp\n\n%DEPENDS%\n";
+    for (int d = 0; d < 12; ++d) {
+      desc << "dependency" << (i + d) % packages << ">=1.0\n";
+    }
+    desc << "\n";
+  }
+  ofstream(dir + "/ALPM_DB_VERSION") << "9\n";
+  return descs;
+}
+
+static void evict(const vector<string> &files) {
+  for (const auto &file : files) {
+    const int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+      posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+      close(fd);
+    }
+  }
+}
+
+static double loadMs(const string &dir, BatchReader::Method method,
+                     size_t &loaded) {
+  PackageTable table;
+  const auto start = Clock::now();
+  LocalDb::load(dir, table, method);
+  const auto elapsed = Clock::now() - start;
+  loaded = table.size();
+  return chrono::duration<double, milli>(elapsed).count();
+}
+
+int main(int argc, char **argv) {
+  const char *tmp = getenv("TMPDIR");
+  const string parent = argc > 1 ? argv[1] : (tmp ? tmp : "/tmp");
+  const long packages = argc > 2 ? atol(argv[2]) : 3000;
+  const int rounds = argc > 3 ? atoi(argv[3]) : 5;
+
+  string pattern = parent + "/aarchup-localdb-XXXXXX";
+  if (!mkdtemp(&pattern[0])) {
+    cerr << "Can't create a directory in " << parent << '\n';
+    return 2;
+  }
+  const string dir = pattern;
+  const vector<string> descs = makeDatabase(dir, packages);
+  sync();
+
+  cout << packages << " packages in " << dir << ", io_uring "
+       << (BatchReader::ioUringAvailable() ? "available" : "unavailable")
+       << '\n';
+  const struct {
+    const char *name;
+    BatchReader::Method method;
+  } methods[] = {{"pread", BatchReader::Method::Pread},
+                 {"io_uring", BatchReader::Method::IoUring}};
+
+  for (const auto &m : methods) {
+    double cold = 0, warm = 0;
+    size_t loaded = 0;
+    for (int r = 0; r < rounds; ++r) {
+      evict(descs);
+      cold += loadMs(dir, m.method, loaded);
+      warm += loadMs(dir, m.method, loaded);
+    }
+    cout << m.name << ": cold " << cold / rounds << " ms, warm "
+         << warm / rounds << " ms (" << loaded << " packages)\n";
+  }
+
+  for (const auto &desc : descs) {
+    unlink(desc.c_str());
+    rmdir(desc.substr(0, desc.size() - 5).c_str());
+  }
+  unlink((dir + "/ALPM_DB_VERSION").c_str());
+  rmdir(dir.c_str());
+  return 0;
+}
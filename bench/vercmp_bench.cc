@@ -0,0 +1,107 @@
+/* Checks Vercmp against a corpus of version pairs and compares its speed
+ * with pacman's vercmp binary when that is installed.
+ *
+ * Usage: aarchup_vercmp_bench [corpus] [iterations] */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CliWrapper.hh"
+#include "Vercmp.hh"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+struct Case {
+  string a;
+  string b;
+  int expected;
+};
+
+static vector<Case> loadCorpus(const char *path) {
+  ifstream in(path);
+  if (!in) {
+    cerr << "Can't open corpus " << path << '\n';
+    exit(2);
+  }
+  vector<Case> cases;
+  string line;
+  while (getline(in, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    istringstream fields(line);
+    Case c;
+    if (fields >> c.a >> c.b >> c.expected) {
+      cases.push_back(c);
+      cases.push_back({c.b, c.a, -c.expected});
+    }
+  }
+  return cases;
+}
+
+static double nsPer(Clock::duration d, size_t n) {
+  return static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(d).count()) /
+         static_cast<double>(n);
+}
+
+int main(int argc, char **argv) {
+  const char *corpus = argc > 1 ? argv[1] : AARCHUP_VERCMP_CORPUS;
+  const long iterations = argc > 2 ? atol(argv[2]) : 2000;
+  const vector<Case> cases = loadCorpus(corpus);
+
+  vector<VersionPair> pairs;
+  for (const auto &c : cases) {
+    pairs.push_back({c.a, c.b});
+  }
+  vector<int> results(pairs.size());
+  vercmpBatch(pairs.data(), pairs.size(), results.data());
+
+  int failures = 0;
+  for (size_t i = 0; i < cases.size(); ++i) {
+    if (results[i] != cases[i].expected) {
+      cerr << "MISMATCH vercmp(" << cases[i].a << ", " << cases[i].b
+           << ") = " << results[i] << ", expected " << cases[i].expected
+           << '\n';
+      ++failures;
+    }
+  }
+  cout << cases.size() << " pairs checked, " << failures << " mismatches\n";
+
+  const auto start = Clock::now();
+  long sink = 0;
+  for (long i = 0; i < iterations; ++i) {
+    vercmpBatch(pairs.data(), pairs.size(), results.data());
+    sink += results[static_cast<size_t>(i) % results.size()];
+  }
+  const auto elapsed = Clock::now() - start;
+  cout << "built-in vercmp: "
+       << nsPer(elapsed, pairs.size() * static_cast<size_t>(iterations))
+       << " ns/pair (checksum " << sink << ")\n";
+
+  /* One process per pair is what shelling out would cost. */
+  if (access("/usr/bin/vercmp", X_OK) == 0) {
+    const auto binStart = Clock::now();
+    for (size_t i = 0; i < cases.size(); ++i) {
+      const string cmd = "/usr/bin/vercmp '" + cases[i].a + "' '" + cases[i].b + "'";
+      CliWrapper vercmpBin(cmd.c_str());
+      const CliResult result = vercmpBin.execute();
+      if (atoi(result.output.str().c_str()) != results[i]) {
+        cerr << "vercmp binary disagrees on " << cases[i].a << ' '
+             << cases[i].b << '\n';
+        ++failures;
+      }
+    }
+    cout << "vercmp binary:   " << nsPer(Clock::now() - binStart, cases.size())
+         << " ns/pair\n";
+  } else {
+    cout << "vercmp binary not found, skipping comparison\n";
+  }
+  return failures == 0 ? 0 : 1;
+}
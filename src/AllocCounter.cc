@@ -0,0 +1,49 @@
+#include "AllocCounter.hh"
+
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+#ifdef AARCHUP_COUNT_ALLOCATIONS
+
+namespace {
+std::atomic<uint64_t> allocations(0);
+}
+
+void *operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  const size_t align = static_cast<size_t>(alignment);
+  /* aligned_alloc() wants a non-zero multiple of the alignment. */
+  const size_t rounded = size ? (size + align - 1) / align * align : align;
+  if (void *p = aligned_alloc(align, rounded)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { free(p); }
+
+bool AllocCounter::enabled() { return true; }
+
+uint64_t AllocCounter::count() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool AllocCounter::enabled() { return false; }
+
+uint64_t AllocCounter::count() { return 0; }
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef AARCHUP_ALLOCCOUNTER_H
+#define AARCHUP_ALLOCCOUNTER_H
+
+#include <cstdint>
+
+/* Counts calls to the global operator new, which AllocCounter.cc replaces
+ * in builds configured with AARCHUP_COUNT_ALLOCATIONS. Other builds keep
+ * the library's and count nothing. Memory C libraries allocate with
+ * malloc() isn't seen. */
+class AllocCounter {
+ public:
+  static bool enabled();
+  static uint64_t count();
+};
+
+#endif
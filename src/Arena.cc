@@ -0,0 +1,75 @@
+#include "Arena.hh"
+
+#include <cstdint>
+#include <new>
+
+using namespace std;
+
+const size_t Arena::DEFAULT_BLOCK_SIZE;
+
+Arena::Arena(size_t initialSize) {
+  _blocks.reserve(8);
+  addBlock(initialSize);
+}
+
+Arena::~Arena() {
+  for (const Block &block : _blocks) {
+    ::operator delete(block.data);
+  }
+}
+
+void Arena::addBlock(size_t size) {
+  Block block;
+  block.data = static_cast<char *>(::operator new(size));
+  block.size = size;
+  _blocks.push_back(block);
+  _ptr = block.data;
+  _end = block.data + size;
+}
+
+size_t Arena::usedInCurrent() const {
+  return static_cast<size_t>(_ptr - _blocks.back().data);
+}
+
+size_t Arena::capacity() const {
+  size_t total = 0;
+  for (const Block &block : _blocks) {
+    total += block.size;
+  }
+  return total;
+}
+
+void Arena::reset() {
+  if (_blocks.size() > 1) {
+    /* Merged, the next check of the same size fits in the first block. */
+    const size_t total = capacity();
+    for (const Block &block : _blocks) {
+      ::operator delete(block.data);
+    }
+    _blocks.clear();
+    addBlock(total);
+  }
+  _ptr = _blocks.front().data;
+  _end = _ptr + _blocks.front().size;
+  _used = 0;
+}
+
+void *Arena::do_allocate(size_t bytes, size_t alignment) {
+  uintptr_t p = reinterpret_cast<uintptr_t>(_ptr);
+  uintptr_t aligned = (p + alignment - 1) & ~(uintptr_t(alignment) - 1);
+  if (aligned + bytes > reinterpret_cast<uintptr_t>(_end)) {
+    _used += usedInCurrent();
+    size_t size = _blocks.back().size * 2;
+    if (size < bytes + alignment) {
+      size = bytes + alignment;
+    }
+    addBlock(size);
+    p = reinterpret_cast<uintptr_t>(_ptr);
+    aligned = (p + alignment - 1) & ~(uintptr_t(alignment) - 1);
+  }
+  _ptr = reinterpret_cast<char *>(aligned + bytes);
+  if (_used + usedInCurrent() > _peak) {
+    _peak = _used + usedInCurrent();
+  }
+  return reinterpret_cast<void *>(aligned);
+}
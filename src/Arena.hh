@@ -0,0 +1,55 @@
+#ifndef AARCHUP_ARENA_H
+#define AARCHUP_ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+/* Bump allocator for memory that lives exactly as long as one check.
+ * Deallocation does nothing; reset() hands everything back at once and
+ * keeps the blocks for the next check. When a check needed more than one
+ * block, reset() trades them for a single block of their combined size, so
+ * a long-running loop settles on one allocation and stops touching the
+ * heap. Not thread-safe. */
+class Arena : public std::pmr::memory_resource {
+  struct Block {
+    char *data;
+    size_t size;
+  };
+
+  std::vector<Block> _blocks;
+  char *_ptr = nullptr;
+  char *_end = nullptr;
+  size_t _used = 0;
+  size_t _peak = 0;
+
+ public:
+  static const size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+  explicit Arena(size_t initialSize = DEFAULT_BLOCK_SIZE);
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+  ~Arena() override;
+
+  /* Forgets every allocation. Anything still pointing into the arena is
+   * left dangling. */
+  void reset();
+
+  size_t capacity() const;
+  /* The most bytes a single check used, padding included. */
+  size_t peak() const { return _peak; }
+
+ protected:
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *, size_t, size_t) override {}
+  bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept override {
+    return this == &other;
+  }
+
+ private:
+  void addBlock(size_t size);
+  size_t usedInCurrent() const;
+};
+
+#endif
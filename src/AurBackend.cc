@@ -0,0 +1,140 @@
+#include "AurBackend.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "AurClient.hh"
+#include "Vercmp.hh"
+#include "XdgDirs.hh"
+
+using namespace std;
+
+AurBackend::AurBackend(string cacheDir, string url)
+    : _cacheDir(std::move(cacheDir)),
+      _url(std::move(url)),
+      _timeout(0),
+      _cacheTtl(0),
+      _cancellable(nullptr) {}
+
+/* Fetches the foreign packages whose cache entries are missing or older
+ * than the TTL. The stale names go out in sorted batches, so a set that
+ * was fetched together comes back as the same batches and its validators
+ * apply. */
+void AurBackend::refresh(const PackageTable &foreign, AurCache &cache) const {
+  const time_t now = time(nullptr);
+  vector<string_view> stale;
+  for (size_t i = 0; i < foreign.size(); ++i) {
+    const AurCache::Entry *entry = cache.find(foreign.name(i));
+    if (!entry || now - entry->fetched >= _cacheTtl.count()) {
+      stale.push_back(foreign.name(i));
+    }
+  }
+  cache.retain([&foreign](string_view name) {
+    return foreign.find(name) < foreign.size();
+  });
+  if (stale.empty()) {
+    return;
+  }
+
+  AurClient client(_url);
+  client.setTimeout(_timeout);
+  client.setCancellable(_cancellable);
+  vector<pair<uint64_t, AurClient::Validators>> round;
+  vector<string_view> batch;
+  vector<string_view> unknown;
+  map<string, string, less<>> versions;
+  /* Asks for batch, conditionally if v is set, and caches the reply.
+   * Returns false on 304, which leaves the cache alone. */
+  auto fetch = [&](AurClient::Validators &v) {
+    versions.clear();
+    if (!client.infoBatch(
+            batch, v, [&versions](string_view name, string_view version) {
+              versions[string(name)] = string(version);
+            })) {
+      return false;
+    }
+    for (const string_view name : batch) {
+      const auto it = versions.find(name);
+      cache.put(name, it == versions.end() ? string_view() : it->second, now);
+    }
+    return true;
+  };
+  for (size_t first = 0; first < stale.size();) {
+    const size_t end = client.batchEnd(stale, first);
+    batch.assign(stale.begin() + first, stale.begin() + end);
+    first = end;
+    const uint64_t key = AurCache::batchKey(batch);
+    AurClient::Validators v = cache.validators(key);
+    if (!fetch(v)) {
+      /* 304: what we have is still current. */
+      for (const string_view name : batch) {
+        const AurCache::Entry *entry = cache.find(name);
+        if (entry) {
+          cache.put(name, entry->version, now);
+        } else {
+          unknown.push_back(name);
+        }
+      }
+    }
+    round.emplace_back(key, v);
+  }
+  /* A 304 says nothing about names the cache has no version of; those are
+   * asked for again without validators. */
+  for (size_t first = 0; first < unknown.size();) {
+    const size_t end = client.batchEnd(unknown, first);
+    batch.assign(unknown.begin() + first, unknown.begin() + end);
+    first = end;
+    AurClient::Validators none;
+    fetch(none);
+  }
+  /* Only this round's batches can come back the same. */
+  cache.clearValidators();
+  for (const auto &r : round) {
+    cache.setValidators(r.first, r.second);
+  }
+}
+
+size_t AurBackend::check(const PackageTable &foreign,
+                         const LineSplitter::LineHandler &onLine) const {
+  if (foreign.empty()) {
+    return 0;
+  }
+
+  AurCache cache;
+  string cachePath;
+  if (_cacheTtl.count() > 0 && !_cacheDir.empty() && makeDirs(_cacheDir)) {
+    cachePath = _cacheDir + "/" + AurCache::FILE_NAME;
+    cache.load(cachePath);
+  }
+  refresh(foreign, cache);
+  if (!cachePath.empty()) {
+    cache.save(cachePath);
+  }
+
+  size_t updates = 0;
+  bool wanted = true;
+  string line;
+  for (size_t i = 0; i < foreign.size(); ++i) {
+    const AurCache::Entry *entry = cache.find(foreign.name(i));
+    if (!entry || entry->version.empty() ||
+        vercmp(entry->version, foreign.version(i)) <= 0) {
+      continue;
+    }
+    ++updates;
+    if (!wanted) {
+      continue;
+    }
+    line.assign(foreign.name(i));
+    line += ' ';
+    line += foreign.version(i);
+    line += " -> ";
+    line += entry->version;
+    wanted = onLine(line);
+  }
+  return updates;
+}
@@ -0,0 +1,46 @@
+#ifndef AARCHUP_AURBACKEND_H
+#define AARCHUP_AURBACKEND_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "AurCache.hh"
+#include "LineSplitter.hh"
+#include "PackageTable.hh"
+
+/* Checks the installed packages no sync repository carries against the
+ * AUR, producing the same "<name> <old> -> <new>" lines as auracle sync. */
+class AurBackend {
+  std::string _cacheDir;
+  std::string _url;
+  std::chrono::seconds _timeout;
+  std::chrono::seconds _cacheTtl;
+  GCancellable *_cancellable;
+
+ public:
+  /* cacheDir holds the AUR cache; empty disables it. url is the aurweb RPC
+   * info endpoint, see AurClient. */
+  AurBackend(std::string cacheDir, std::string url);
+
+  void setTimeout(std::chrono::seconds timeout) { _timeout = timeout; }
+
+  /* Versions fetched less than ttl ago are taken from the cache. Older
+   * ones are asked for again, conditionally where the server gave
+   * validators. A zero ttl queries everything every time. */
+  void setCacheTtl(std::chrono::seconds ttl) { _cacheTtl = ttl; }
+
+  /* See AurClient::setCancellable(). */
+  void setCancellable(GCancellable *cancellable) { _cancellable = cancellable; }
+
+  /* Hands each pending AUR update of the foreign packages, as
+   * NativeBackend::check() lists them, to onLine and returns how many there
+   * were. Throws std::runtime_error if the AUR can't be queried. */
+  size_t check(const PackageTable &foreign,
+               const LineSplitter::LineHandler &onLine) const;
+
+ private:
+  void refresh(const PackageTable &foreign, AurCache &cache) const;
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include "AurCache.hh"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+const char *const AurCache::FILE_NAME = "aur.cache";
+
+static const char CACHE_VERSION[] = "aarchup-aur-cache 1";
+
+/* Lines are tab separated:
+ *   P <fetched> <name> <version>
+ *   V <batch key> <etag> <last-modified> */
+void AurCache::load(const string &path) {
+  _entries.clear();
+  _validators.clear();
+  ifstream in(path);
+  string line;
+  if (!getline(in, line) || line != CACHE_VERSION) {
+    return;
+  }
+  string fields[4];
+  while (getline(in, line)) {
+    istringstream columns(line);
+    size_t count = 0;
+    while (count < 4 && getline(columns, fields[count], '\t')) {
+      ++count;
+    }
+    /* getline() drops a trailing empty field, an unknown package's
+     * version or a missing Last-Modified. */
+    if (count < 4) {
+      fields[3].clear();
+    }
+    if (count >= 3 && fields[0] == "P") {
+      Entry &entry = _entries[fields[2]];
+      entry.fetched = static_cast<time_t>(strtoll(fields[1].c_str(), nullptr, 10));
+      entry.version = fields[3];
+    } else if (count >= 3 && fields[0] == "V") {
+      AurClient::Validators &v =
+          _validators[strtoull(fields[1].c_str(), nullptr, 16)];
+      v.etag = fields[2];
+      v.lastModified = fields[3];
+    } else {
+      /* Damaged; start over rather than trust the rest. */
+      _entries.clear();
+      _validators.clear();
+      return;
+    }
+  }
+}
+
+bool AurCache::save(const string &path) const {
+  ostringstream out;
+  out << CACHE_VERSION << '\n';
+  for (const auto &e : _entries) {
+    out << "P\t" << e.second.fetched << '\t' << e.first << '\t'
+        << e.second.version << '\n';
+  }
+  for (const auto &v : _validators) {
+    out << "V\t" << hex << v.first << dec << '\t' << v.second.etag << '\t'
+        << v.second.lastModified << '\n';
+  }
+  const string text = out.str();
+
+  /* Write aside and rename; the temporary name is unique, so two
+   * instances saving at once never write into the same file. */
+  string tmpPath = path + ".XXXXXX";
+  const int fd = mkostemp(&tmpPath[0], O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  fchmod(fd, 0644);
+  FILE *file = fdopen(fd, "w");
+  if (!file) {
+    close(fd);
+    unlink(tmpPath.c_str());
+    return false;
+  }
+  const bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+  if (fclose(file) != 0 || !written ||
+      rename(tmpPath.c_str(), path.c_str()) != 0) {
+    unlink(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+const AurCache::Entry *AurCache::find(string_view name) const {
+  const auto it = _entries.find(name);
+  return it == _entries.end() ? nullptr : &it->second;
+}
+
+void AurCache::put(string_view name, string_view version, time_t fetched) {
+  const auto it = _entries.find(name);
+  Entry &entry = it != _entries.end() ? it->second : _entries[string(name)];
+  entry.version.assign(version.data(), version.size());
+  entry.fetched = fetched;
+}
+
+void AurCache::retain(const function<bool(string_view)> &keep) {
+  for (auto it = _entries.begin(); it != _entries.end();) {
+    it = keep(it->first) ? next(it) : _entries.erase(it);
+  }
+}
+
+AurClient::Validators AurCache::validators(uint64_t key) const {
+  const auto it = _validators.find(key);
+  return it == _validators.end() ? AurClient::Validators() : it->second;
+}
+
+void AurCache::setValidators(uint64_t key,
+                             const AurClient::Validators &validators) {
+  if (validators.empty()) {
+    _validators.erase(key);
+  } else {
+    _validators[key] = validators;
+  }
+}
+
+uint64_t AurCache::batchKey(const vector<string_view> &names) {
+  /* FNV-1a over the names, each terminated by '\n'. */
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const string_view name : names) {
+    for (const char c : name) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 0x100000001b3ULL;
+    }
+    hash ^= '\n';
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
@@ -0,0 +1,51 @@
+#ifndef AARCHUP_AURCACHE_H
+#define AARCHUP_AURCACHE_H
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AurClient.hh"
+
+/* AUR versions of the foreign packages as last fetched, plus the HTTP
+ * validators of the replies they came in, kept in
+ * $XDG_CACHE_HOME/aarchup/aur.cache between runs. */
+class AurCache {
+ public:
+  struct Entry {
+    /* Empty when the AUR doesn't know the package. */
+    std::string version;
+    time_t fetched = 0;
+  };
+
+  static const char *const FILE_NAME;
+
+  /* A missing or damaged file leaves the cache empty. */
+  void load(const std::string &path);
+
+  /* Writes aside and renames over path. Returns false on failure. */
+  bool save(const std::string &path) const;
+
+  const Entry *find(std::string_view name) const;
+  void put(std::string_view name, std::string_view version, time_t fetched);
+
+  /* Drops every entry keep returns false for. */
+  void retain(const std::function<bool(std::string_view name)> &keep);
+
+  /* Validators are stored per batch, keyed by batchKey() of its names. */
+  AurClient::Validators validators(uint64_t key) const;
+  void setValidators(uint64_t key, const AurClient::Validators &validators);
+  void clearValidators() { _validators.clear(); }
+
+  static uint64_t batchKey(const std::vector<std::string_view> &names);
+
+ private:
+  std::map<std::string, Entry, std::less<>> _entries;
+  std::map<uint64_t, AurClient::Validators> _validators;
+};
+
+#endif
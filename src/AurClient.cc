@@ -0,0 +1,407 @@
+#include "AurClient.hh"
+
+#include <ctype.h>
+#include <gio/gio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+const char *const AurClient::DEFAULT_URL = "https://aur.archlinux.org/rpc/v5/info";
+const size_t AurClient::BATCH;
+const size_t AurClient::MAX_TARGET;
+const size_t AurClient::BUFFER_SIZE;
+
+[[noreturn]] static void fail(const string &what, GError *error = nullptr) {
+  std::stringstream ss;
+  ss << "AUR request failed: " << what;
+  if (error) {
+    ss << ": " << error->message;
+    g_error_free(error);
+  }
+  throw std::runtime_error(ss.str());
+}
+
+/* "arg[]=", encoded, before every name. */
+static const char ARG[] = "arg%5B%5D=";
+
+static bool unreserved(char c) {
+  return isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '.' ||
+         c == '_' || c == '~';
+}
+
+/* The size of s percent-encoded. */
+static size_t encodedSize(string_view s) {
+  size_t size = s.size();
+  for (const char c : s) {
+    if (!unreserved(c)) {
+      size += 2;
+    }
+  }
+  return size;
+}
+
+/* Appends s percent-encoded for a query. */
+static void percentEncode(string &out, string_view s) {
+  static const char hex[] = "0123456789ABCDEF";
+  for (const char c : s) {
+    if (unreserved(c)) {
+      out.push_back(c);
+    } else {
+      out.push_back('%');
+      out.push_back(hex[static_cast<unsigned char>(c) >> 4]);
+      out.push_back(hex[static_cast<unsigned char>(c) & 0xf]);
+    }
+  }
+}
+
+static bool startsWithNoCase(const string &s, const char *prefix) {
+  const size_t len = strlen(prefix);
+  return s.size() >= len && strncasecmp(s.c_str(), prefix, len) == 0;
+}
+
+/* The value of a "Name: value" header line. */
+static string headerValue(const string &line) {
+  const size_t colon = line.find(':');
+  const size_t start = line.find_first_not_of(' ', colon + 1);
+  return start == string::npos ? string() : line.substr(start);
+}
+
+AurClient::AurClient(const string &url)
+    : _timeout(0),
+      _cancellable(nullptr),
+      _client(nullptr),
+      _connection(nullptr),
+      _reused(false),
+      _buffer(new char[BUFFER_SIZE]),
+      _begin(0),
+      _end(0) {
+  size_t hostStart;
+  if (url.compare(0, 8, "https://") == 0) {
+    _tls = true;
+    hostStart = 8;
+  } else if (url.compare(0, 7, "http://") == 0) {
+    _tls = false;
+    hostStart = 7;
+  } else {
+    std::stringstream ss;
+    ss << "Unsupported AUR URL '" << url << "', expected http:// or https://";
+    throw std::runtime_error(ss.str());
+  }
+  const size_t slash = url.find('/', hostStart);
+  _hostAndPort = url.substr(hostStart, slash - hostStart);
+  _path = slash == string::npos ? "/" : url.substr(slash);
+  if (_hostAndPort.empty()) {
+    std::stringstream ss;
+    ss << "No host in AUR URL '" << url << "'";
+    throw std::runtime_error(ss.str());
+  }
+}
+
+AurClient::~AurClient() {
+  disconnect();
+  if (_client) {
+    g_object_unref(_client);
+  }
+}
+
+void AurClient::setTimeout(chrono::seconds timeout) {
+  _timeout = static_cast<unsigned>(timeout.count());
+  if (_client) {
+    g_socket_client_set_timeout(_client, _timeout);
+  }
+}
+
+void AurClient::connect() {
+  if (!_client) {
+    _client = g_socket_client_new();
+    g_socket_client_set_tls(_client, _tls);
+    g_socket_client_set_timeout(_client, _timeout);
+  }
+  GError *error = nullptr;
+  _connection = g_socket_client_connect_to_host(
+      _client, _hostAndPort.c_str(), _tls ? 443 : 80, _cancellable, &error);
+  if (!_connection) {
+    fail("can't connect to " + _hostAndPort, error);
+  }
+  _reused = false;
+  _begin = _end = 0;
+}
+
+void AurClient::disconnect() {
+  if (_connection) {
+    g_io_stream_close(G_IO_STREAM(_connection), nullptr, nullptr);
+    g_object_unref(_connection);
+    _connection = nullptr;
+  }
+}
+
+/* Tops up the read buffer; false at end of stream. */
+bool AurClient::fill() {
+  if (_begin == _end) {
+    _begin = _end = 0;
+  }
+  GError *error = nullptr;
+  GInputStream *in = g_io_stream_get_input_stream(G_IO_STREAM(_connection));
+  const gssize n = g_input_stream_read(in, _buffer.get() + _end,
+                                       BUFFER_SIZE - _end, _cancellable,
+                                       &error);
+  if (n < 0) {
+    fail("read from " + _hostAndPort, error);
+  }
+  _end += static_cast<size_t>(n);
+  return n > 0;
+}
+
+bool AurClient::readLine(string &line) {
+  line.clear();
+  while (true) {
+    const char *begin = _buffer.get() + _begin;
+    const char *end = _buffer.get() + _end;
+    const char *nl = static_cast<const char *>(memchr(begin, '\n', end - begin));
+    if (nl) {
+      line.append(begin, nl - begin);
+      _begin += static_cast<size_t>(nl - begin) + 1;
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+      return true;
+    }
+    line.append(begin, end - begin);
+    _begin = _end;
+    if (line.size() > BUFFER_SIZE) {
+      fail("header line too long");
+    }
+    if (!fill()) {
+      return false;
+    }
+  }
+}
+
+void AurClient::readBody(size_t length, AurInfoParser &parser) {
+  while (length > 0) {
+    if (_begin == _end && !fill()) {
+      fail("connection closed mid-reply");
+    }
+    const size_t take = min(length, _end - _begin);
+    if (!parser.feed(_buffer.get() + _begin, take)) {
+      fail("bad JSON in reply: " + parser.error());
+    }
+    _begin += take;
+    length -= take;
+  }
+}
+
+void AurClient::readChunked(AurInfoParser &parser) {
+  string line;
+  while (true) {
+    if (!readLine(line)) {
+      fail("connection closed mid-reply");
+    }
+    /* Chunk extensions after ';' are ignored. */
+    const size_t length = strtoul(line.c_str(), nullptr, 16);
+    if (length == 0) {
+      break;
+    }
+    readBody(length, parser);
+    if (!readLine(line)) {
+      fail("connection closed mid-reply");
+    }
+  }
+  /* Trailers, up to the empty line. */
+  while (readLine(line) && !line.empty()) {
+  }
+}
+
+void AurClient::readToEof(AurInfoParser &parser) {
+  do {
+    if (_begin < _end && !parser.feed(_buffer.get() + _begin, _end - _begin)) {
+      fail("bad JSON in reply: " + parser.error());
+    }
+    _begin = _end;
+  } while (fill());
+}
+
+/* Sends one request and parses the reply. Returns the HTTP status, 200 or
+ * 304, or 0 with nothing fed to parser if a reused connection turned out
+ * to be closed by the server, so the caller can retry on a fresh one. */
+int AurClient::get(const string &target, Validators &validators,
+                   AurInfoParser &parser) {
+  if (!_connection) {
+    connect();
+  }
+  const bool reused = _reused;
+  std::stringstream request;
+  request << "GET " << target << " HTTP/1.1\r\n"
+          << "Host: " << _hostAndPort << "\r\n"
+          << "User-Agent: aarchup\r\n"
+          << "Accept: application/json\r\n";
+  if (!validators.etag.empty()) {
+    request << "If-None-Match: " << validators.etag << "\r\n";
+  }
+  if (!validators.lastModified.empty()) {
+    request << "If-Modified-Since: " << validators.lastModified << "\r\n";
+  }
+  request << "Connection: keep-alive\r\n\r\n";
+  const string data = request.str();
+  GError *error = nullptr;
+  GOutputStream *out = g_io_stream_get_output_stream(G_IO_STREAM(_connection));
+  if (!g_output_stream_write_all(out, data.data(), data.size(), nullptr,
+                                 _cancellable, &error)) {
+    disconnect();
+    if (reused) {
+      g_error_free(error);
+      return 0;
+    }
+    fail("write to " + _hostAndPort, error);
+  }
+
+  string line;
+  bool statusRead;
+  try {
+    statusRead = readLine(line);
+  } catch (const std::runtime_error &) {
+    disconnect();
+    if (reused) {
+      return 0;
+    }
+    throw;
+  }
+  if (!statusRead) {
+    disconnect();
+    if (reused) {
+      return 0;
+    }
+    fail(_hostAndPort + " closed the connection without a reply");
+  }
+  /* "HTTP/1.1 200 OK" */
+  const bool http10 = line.compare(0, 9, "HTTP/1.0 ") == 0;
+  const size_t space = line.find(' ');
+  const int status =
+      space == string::npos ? 0 : atoi(line.c_str() + space + 1);
+
+  bool chunked = false;
+  bool keepAlive = !http10;
+  long long length = -1;
+  string etag;
+  string lastModified;
+  while (true) {
+    if (!readLine(line)) {
+      fail("connection closed in the reply headers");
+    }
+    if (line.empty()) {
+      break;
+    }
+    if (startsWithNoCase(line, "content-length:")) {
+      length = atoll(line.c_str() + 15);
+    } else if (startsWithNoCase(line, "transfer-encoding:")) {
+      chunked = line.find("chunked") != string::npos;
+    } else if (startsWithNoCase(line, "connection:")) {
+      const char *value = line.c_str() + 11;
+      keepAlive = http10 ? strcasestr(value, "keep-alive") != nullptr
+                         : strcasestr(value, "close") == nullptr;
+    } else if (startsWithNoCase(line, "etag:")) {
+      etag = headerValue(line);
+    } else if (startsWithNoCase(line, "last-modified:")) {
+      lastModified = headerValue(line);
+    }
+  }
+  if (status == 304) {
+    /* No body; the validators still hold. */
+    if (!keepAlive) {
+      disconnect();
+    } else {
+      _reused = true;
+    }
+    return status;
+  }
+  if (status != 200) {
+    disconnect();
+    std::stringstream ss;
+    ss << _hostAndPort << _path << " answered HTTP " << status;
+    fail(ss.str());
+  }
+
+  if (chunked) {
+    readChunked(parser);
+  } else if (length >= 0) {
+    readBody(static_cast<size_t>(length), parser);
+  } else {
+    readToEof(parser);
+    keepAlive = false;
+  }
+  if (keepAlive) {
+    _reused = true;
+  } else {
+    disconnect();
+  }
+  validators.etag = etag;
+  validators.lastModified = lastModified;
+  return status;
+}
+
+void AurClient::info(const vector<string_view> &names,
+                     const AurInfoParser::PackageHandler &onPackage) {
+  Validators none;
+  vector<string_view> batch;
+  for (size_t first = 0; first < names.size();) {
+    const size_t end = batchEnd(names, first);
+    batch.assign(names.begin() + first, names.begin() + end);
+    first = end;
+    none = Validators();
+    infoBatch(batch, none, onPackage);
+  }
+}
+
+size_t AurClient::batchEnd(const vector<string_view> &names,
+                           size_t first) const {
+  const size_t last = min(names.size(), first + BATCH);
+  size_t size = _path.size();
+  size_t end = first;
+  while (end < last) {
+    /* '?' or '&', "arg[]=" and the name */
+    size += sizeof(ARG) + encodedSize(names[end]);
+    if (size > MAX_TARGET && end > first) {
+      break;
+    }
+    ++end;
+  }
+  return end;
+}
+
+bool AurClient::infoBatch(const vector<string_view> &names,
+                          Validators &validators,
+                          const AurInfoParser::PackageHandler &onPackage) {
+  /* The first argument starts the query, or continues one in the URL. */
+  string target = _path;
+  char separator = _path.find('?') == string::npos ? '?' : '&';
+  for (const string_view name : names) {
+    target.push_back(separator);
+    target += ARG;
+    percentEncode(target, name);
+    separator = '&';
+  }
+  AurInfoParser parser(onPackage);
+  int status;
+  try {
+    status = get(target, validators, parser);
+    if (status == 0) {
+      status = get(target, validators, parser);
+    }
+  } catch (...) {
+    /* Whatever is left of the reply would be read as the next one. */
+    disconnect();
+    throw;
+  }
+  if (status == 304) {
+    return false;
+  }
+  if (!parser.finish()) {
+    fail(parser.error());
+  }
+  return true;
+}
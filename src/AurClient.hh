@@ -0,0 +1,95 @@
+#ifndef AARCHUP_AURCLIENT_H
+#define AARCHUP_AURCLIENT_H
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AurInfoParser.hh"
+
+typedef struct _GCancellable GCancellable;
+typedef struct _GSocketClient GSocketClient;
+typedef struct _GSocketConnection GSocketConnection;
+
+/* Minimal HTTP/1.1 client for the aurweb RPC "info" endpoint. Names are
+ * sent in batches as the query of GET requests, which unlike POST can be
+ * made conditional, over one kept-alive connection, and replies are parsed
+ * while they stream in. */
+class AurClient {
+  std::string _hostAndPort;
+  std::string _path;
+  bool _tls;
+  unsigned _timeout;
+  GCancellable *_cancellable;
+  GSocketClient *_client;
+  GSocketConnection *_connection;
+  bool _reused;
+  std::unique_ptr<char[]> _buffer;
+  size_t _begin;
+  size_t _end;
+
+ public:
+  static const char *const DEFAULT_URL;
+  /* aurweb rejects replies of more than 5000 results; stay well clear and
+   * keep each request small. */
+  static const size_t BATCH = 150;
+  /* aurweb answers 414 to request targets longer than 4443 bytes. */
+  static const size_t MAX_TARGET = 4096;
+  static const size_t BUFFER_SIZE = 16 * 1024;
+
+  /* url is the info endpoint, http:// or https://. Throws
+   * std::runtime_error if it can't be parsed. */
+  explicit AurClient(const std::string &url);
+  AurClient(const AurClient &) = delete;
+  AurClient &operator=(const AurClient &) = delete;
+  ~AurClient();
+
+  /* HTTP cache validators of one batch's reply. */
+  struct Validators {
+    std::string etag;
+    std::string lastModified;
+    bool empty() const { return etag.empty() && lastModified.empty(); }
+  };
+
+  /* Limits every connect, read and write; zero waits forever. */
+  void setTimeout(std::chrono::seconds timeout);
+
+  /* Cancelling cancellable aborts the request in progress and makes later
+   * ones fail. Not owned; nullptr for none. */
+  void setCancellable(GCancellable *cancellable) { _cancellable = cancellable; }
+
+  /* The end of the batch starting at names[first]: at most BATCH names
+   * whose request target fits in MAX_TARGET, and at least one name. */
+  size_t batchEnd(const std::vector<std::string_view> &names,
+                  size_t first) const;
+
+  /* Looks up names and hands every package the AUR knows to onPackage.
+   * Names it doesn't know are skipped. Throws std::runtime_error on
+   * network, HTTP or RPC errors. */
+  void info(const std::vector<std::string_view> &names,
+            const AurInfoParser::PackageHandler &onPackage);
+
+  /* Sends a single request for up to BATCH names. Set validators make it
+   * conditional: if the server answers 304 Not Modified nothing is
+   * reported and false is returned. validators is updated from the
+   * reply. Throws like info(). */
+  bool infoBatch(const std::vector<std::string_view> &names,
+                 Validators &validators,
+                 const AurInfoParser::PackageHandler &onPackage);
+
+ private:
+  void connect();
+  void disconnect();
+  int get(const std::string &target, Validators &validators,
+          AurInfoParser &parser);
+  bool fill();
+  bool readLine(std::string &line);
+  void readBody(size_t length, AurInfoParser &parser);
+  void readChunked(AurInfoParser &parser);
+  void readToEof(AurInfoParser &parser);
+};
+
+#endif
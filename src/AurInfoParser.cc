@@ -0,0 +1,227 @@
+#include "AurInfoParser.hh"
+
+#include <string.h>
+#include <utility>
+
+using namespace std;
+
+AurInfoParser::AurInfoParser(PackageHandler onPackage)
+    : _onPackage(std::move(onPackage)) {
+  _stack.reserve(8);
+}
+
+bool AurInfoParser::fail(const char *what) {
+  if (_error.empty()) {
+    _error = what;
+  }
+  return false;
+}
+
+/* A results entry is an object directly inside the top-level "results"
+ * array. */
+bool AurInfoParser::inResult() const {
+  return _stack.size() == 3 && _topKey == "results";
+}
+
+void AurInfoParser::appendUtf8(unsigned cp) {
+  if (cp < 0x80) {
+    _token.push_back(static_cast<char>(cp));
+  } else if (cp < 0x800) {
+    _token.push_back(static_cast<char>(0xc0 | (cp >> 6)));
+    _token.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+  } else if (cp < 0x10000) {
+    _token.push_back(static_cast<char>(0xe0 | (cp >> 12)));
+    _token.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+    _token.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+  } else {
+    _token.push_back(static_cast<char>(0xf0 | (cp >> 18)));
+    _token.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+    _token.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+    _token.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+  }
+}
+
+void AurInfoParser::stringDone() {
+  if (_expectKey) {
+    _key.swap(_token);
+    _expectKey = false;
+  } else if (_stack.size() == 1) {
+    if (_key == "type") {
+      _type = _token;
+    } else if (_key == "error") {
+      _rpcError = _token;
+    }
+  } else if (inResult()) {
+    if (_key == "Name") {
+      _name = _token;
+    } else if (_key == "Version") {
+      _version = _token;
+    }
+  }
+  _token.clear();
+}
+
+bool AurInfoParser::structural(char c) {
+  switch (c) {
+    case '{':
+    case '[':
+      if (_expectKey || _done) {
+        return fail("unexpected container");
+      }
+      if (_stack.size() == 1) {
+        _topKey = _key;
+      }
+      if (c == '{' && _stack.size() == 2 && _topKey == "results") {
+        _name.clear();
+        _version.clear();
+      }
+      _stack.push_back(c);
+      _expectKey = c == '{';
+      return true;
+    case '}':
+    case ']':
+      if (_stack.empty() || _stack.back() != (c == '}' ? '{' : '[')) {
+        return fail("unbalanced brackets");
+      }
+      if (c == '}' && inResult() && !_name.empty() && !_version.empty()) {
+        _onPackage(_name, _version);
+      }
+      _stack.pop_back();
+      _expectKey = false;
+      _done = _stack.empty();
+      return true;
+    case ',':
+      if (_stack.empty()) {
+        return fail("stray ','");
+      }
+      _expectKey = _stack.back() == '{';
+      return true;
+    case ':':
+      if (_stack.empty() || _stack.back() != '{') {
+        return fail("stray ':'");
+      }
+      return true;
+    default:
+      return fail("unexpected character");
+  }
+}
+
+bool AurInfoParser::feed(const char *data, size_t size) {
+  if (!_error.empty()) {
+    return false;
+  }
+  const char *end = data + size;
+  while (data < end) {
+    const char c = *data;
+    switch (_lex) {
+      case Lex::Value:
+        ++data;
+        if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+          break;
+        }
+        if (c == '"') {
+          if (_done) {
+            return fail("trailing data");
+          }
+          _lex = Lex::String;
+        } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' ||
+                   c == 'f' || c == 'n') {
+          if (_expectKey || _done) {
+            return fail("unexpected literal");
+          }
+          _lex = Lex::Literal;
+        } else if (!structural(c)) {
+          return false;
+        }
+        break;
+      case Lex::String: {
+        /* Copy the run up to the next quote or escape in one go. */
+        const char *stop = data;
+        while (stop < end && *stop != '"' && *stop != '\\') {
+          ++stop;
+        }
+        _token.append(data, static_cast<size_t>(stop - data));
+        data = stop;
+        if (data < end) {
+          _lex = *data == '"' ? Lex::Value : Lex::Escape;
+          if (*data == '"') {
+            stringDone();
+          }
+          ++data;
+        }
+        break;
+      }
+      case Lex::Escape:
+        ++data;
+        _lex = Lex::String;
+        switch (c) {
+          case 'b': _token.push_back('\b'); break;
+          case 'f': _token.push_back('\f'); break;
+          case 'n': _token.push_back('\n'); break;
+          case 'r': _token.push_back('\r'); break;
+          case 't': _token.push_back('\t'); break;
+          case 'u':
+            _lex = Lex::Unicode;
+            _unicode = 0;
+            _unicodeDigits = 0;
+            break;
+          case '"':
+          case '\\':
+          case '/':
+            _token.push_back(c);
+            break;
+          default:
+            return fail("bad escape");
+        }
+        break;
+      case Lex::Unicode: {
+        ++data;
+        const char *hex = "0123456789abcdef";
+        const char *digit = c ? strchr(hex, c | 0x20) : nullptr;
+        if (!digit) {
+          return fail("bad \\u escape");
+        }
+        _unicode = _unicode * 16 + static_cast<unsigned>(digit - hex);
+        if (++_unicodeDigits < 4) {
+          break;
+        }
+        _lex = Lex::String;
+        if (_unicode >= 0xd800 && _unicode < 0xdc00) {
+          _highSurrogate = _unicode;
+        } else if (_unicode >= 0xdc00 && _unicode < 0xe000 && _highSurrogate) {
+          appendUtf8(0x10000 + ((_highSurrogate - 0xd800) << 10) +
+                     (_unicode - 0xdc00));
+          _highSurrogate = 0;
+        } else {
+          appendUtf8(_unicode);
+          _highSurrogate = 0;
+        }
+        break;
+      }
+      case Lex::Literal:
+        /* Numbers, true, false and null carry nothing of interest. */
+        if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '.' ||
+            c == '+' || c == '-' || c == 'E') {
+          ++data;
+        } else {
+          _lex = Lex::Value;
+        }
+        break;
+    }
+  }
+  return true;
+}
+
+bool AurInfoParser::finish() {
+  if (!_error.empty()) {
+    return false;
+  }
+  if (!_done || _lex == Lex::String) {
+    return fail("truncated reply");
+  }
+  if (_type == "error") {
+    return fail(_rpcError.empty() ? "error reply without a message"
+                                  : _rpcError.c_str());
+  }
+  return true;
+}
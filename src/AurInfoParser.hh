@@ -0,0 +1,57 @@
+#ifndef AARCHUP_AURINFOPARSER_H
+#define AARCHUP_AURINFOPARSER_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Incremental parser for aurweb RPC "info" replies. The body is fed in
+ * whatever pieces the socket hands out and each entry of "results" is
+ * reported as soon as its object closes, so a reply is never held in
+ * memory as a whole. Everything but Name and Version is skipped. */
+class AurInfoParser {
+ public:
+  typedef std::function<void(std::string_view name, std::string_view version)>
+      PackageHandler;
+
+  explicit AurInfoParser(PackageHandler onPackage);
+
+  /* Returns false on malformed JSON; error() tells why. */
+  bool feed(const char *data, size_t size);
+
+  /* Returns false if the document is incomplete or the RPC replied with an
+   * error, which error() then holds. */
+  bool finish();
+
+  const std::string &error() const { return _error; }
+
+ private:
+  enum class Lex { Value, String, Escape, Unicode, Literal };
+
+  PackageHandler _onPackage;
+  std::vector<char> _stack;
+  bool _expectKey = false;
+  bool _done = false;
+  Lex _lex = Lex::Value;
+  std::string _token;
+  std::string _key;
+  std::string _topKey;
+  std::string _name;
+  std::string _version;
+  std::string _type;
+  std::string _rpcError;
+  std::string _error;
+  unsigned _unicode = 0;
+  unsigned _unicodeDigits = 0;
+  unsigned _highSurrogate = 0;
+
+  bool fail(const char *what);
+  bool structural(char c);
+  void stringDone();
+  void appendUtf8(unsigned codePoint);
+  bool inResult() const;
+};
+
+#endif
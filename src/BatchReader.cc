@@ -0,0 +1,327 @@
+#include "BatchReader.hh"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <memory>
+#ifdef AARCHUP_HAVE_IO_URING
+#include <linux/io_uring.h>
+#endif
+
+using namespace std;
+
+const unsigned BatchReader::BATCH;
+const size_t BatchReader::SLOT_SIZE;
+
+/* Appends the rest of fd, from offset on, to contents. */
+static bool preadRest(int fd, off_t offset, string &contents) {
+  char chunk[4096];
+  while (true) {
+    const ssize_t n = pread(fd, chunk, sizeof(chunk), offset);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    if (n == 0) {
+      return true;
+    }
+    contents.append(chunk, static_cast<size_t>(n));
+    offset += n;
+  }
+}
+
+static void readAllPread(int dirfd, const vector<string> &paths,
+                         const BatchReader::FileHandler &onFile, size_t first) {
+  string contents;
+  for (size_t i = first; i < paths.size(); ++i) {
+    const int fd = openat(dirfd, paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      continue;
+    }
+    contents.clear();
+    const bool ok = preadRest(fd, 0, contents);
+    close(fd);
+    if (ok) {
+      onFile(i, contents);
+    }
+  }
+}
+
+#ifdef AARCHUP_HAVE_IO_URING
+namespace {
+
+/* Just enough of an io_uring to submit a batch and wait for all of it. */
+class Ring {
+  int _fd = -1;
+  void *_sqMap = MAP_FAILED;
+  size_t _sqMapSize = 0;
+  void *_cqMap = MAP_FAILED;
+  size_t _cqMapSize = 0;
+  io_uring_sqe *_sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+  size_t _sqesSize = 0;
+
+  unsigned *_sqTail = nullptr;
+  unsigned *_sqMask = nullptr;
+  unsigned *_sqArray = nullptr;
+  unsigned *_cqHead = nullptr;
+  unsigned *_cqTail = nullptr;
+  unsigned *_cqMask = nullptr;
+  io_uring_cqe *_cqes = nullptr;
+  unsigned _queued = 0;
+
+ public:
+  Ring() = default;
+  Ring(const Ring &) = delete;
+  Ring &operator=(const Ring &) = delete;
+
+  ~Ring() {
+    if (_sqes != MAP_FAILED) {
+      munmap(_sqes, _sqesSize);
+    }
+    if (_cqMap != MAP_FAILED && _cqMap != _sqMap) {
+      munmap(_cqMap, _cqMapSize);
+    }
+    if (_sqMap != MAP_FAILED) {
+      munmap(_sqMap, _sqMapSize);
+    }
+    if (_fd >= 0) {
+      close(_fd);
+    }
+  }
+
+  bool init(unsigned entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    _fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (_fd < 0) {
+      return false;
+    }
+    _sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) {
+      _sqMapSize = _cqMapSize = max(_sqMapSize, _cqMapSize);
+    }
+    _sqMap = mmap(nullptr, _sqMapSize, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+    if (_sqMap == MAP_FAILED) {
+      return false;
+    }
+    _cqMap = single ? _sqMap
+                    : mmap(nullptr, _cqMapSize, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+    if (_cqMap == MAP_FAILED) {
+      return false;
+    }
+    _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    _sqes = static_cast<io_uring_sqe *>(
+        mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES));
+    if (_sqes == MAP_FAILED) {
+      return false;
+    }
+    char *sq = static_cast<char *>(_sqMap);
+    char *cq = static_cast<char *>(_cqMap);
+    _sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    _sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    _sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    _cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    _cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    _cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    _cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  io_uring_sqe *next(uint8_t opcode, uint64_t userData) {
+    const unsigned tail = *_sqTail + _queued;
+    const unsigned index = tail & *_sqMask;
+    io_uring_sqe *sqe = &_sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->user_data = userData;
+    _sqArray[index] = index;
+    ++_queued;
+    return sqe;
+  }
+
+  /* Submits everything queued, waits for as many completions and passes
+   * each (user data, result) to onComplete. On failure the entries the
+   * kernel never took are dropped, but it still waits for every one it did
+   * take, so no buffer or fd of the batch is in use once this returns. */
+  template <class Handler>
+  bool run(Handler onComplete) {
+    unsigned unsubmitted = _queued;
+    unsigned inFlight = 0;
+    __atomic_store_n(_sqTail, *_sqTail + _queued, __ATOMIC_RELEASE);
+    _queued = 0;
+    bool ok = true;
+    while (unsubmitted > 0 || inFlight > 0) {
+      const long ret = syscall(__NR_io_uring_enter, _fd, unsubmitted,
+                               unsubmitted + inFlight, IORING_ENTER_GETEVENTS,
+                               nullptr, 0);
+      bool waited = true;
+      if (ret >= 0) {
+        unsubmitted -= static_cast<unsigned>(ret);
+        inFlight += static_cast<unsigned>(ret);
+      } else if (errno != EINTR) {
+        if (unsubmitted > 0) {
+          /* Nothing else reads the tail between io_uring_enter calls. */
+          __atomic_store_n(_sqTail, *_sqTail - unsubmitted, __ATOMIC_RELEASE);
+          unsubmitted = 0;
+        }
+        ok = false;
+        waited = false;
+      }
+      unsigned head = *_cqHead;
+      const unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+      if (head == tail && !waited) {
+        /* io_uring_enter can't wait for us; poll until the rest are in. */
+        const timespec pause = {0, 1000000};
+        nanosleep(&pause, nullptr);
+      }
+      for (; head != tail; ++head, --inFlight) {
+        const io_uring_cqe &cqe = _cqes[head & *_cqMask];
+        onComplete(cqe.user_data, cqe.res);
+      }
+      __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+    }
+    return ok;
+  }
+};
+
+/* Returns the index of the first path not handled, paths.size() when the
+ * whole list went through io_uring. */
+size_t readAllIoUring(int dirfd, const vector<string> &paths,
+                      const BatchReader::FileHandler &onFile) {
+  /* Declared before the ring, so it outlives anything the ring writes. */
+  unique_ptr<char[]> slots(new char[BatchReader::BATCH * BatchReader::SLOT_SIZE]);
+  Ring ring;
+  if (!ring.init(BatchReader::BATCH)) {
+    return 0;
+  }
+  int fds[BatchReader::BATCH];
+  int lengths[BatchReader::BATCH];
+  string contents;
+  /* Closes whatever of this batch is still open, before giving up on it. */
+  auto closeOpen = [&fds](unsigned count) {
+    for (unsigned j = 0; j < count; ++j) {
+      if (fds[j] >= 0) {
+        close(fds[j]);
+      }
+    }
+  };
+
+  for (size_t first = 0; first < paths.size(); first += BatchReader::BATCH) {
+    const unsigned count = static_cast<unsigned>(
+        min<size_t>(BatchReader::BATCH, paths.size() - first));
+
+    for (unsigned j = 0; j < count; ++j) {
+      fds[j] = -1;
+      io_uring_sqe *sqe = ring.next(IORING_OP_OPENAT, j);
+      sqe->fd = dirfd;
+      sqe->addr = reinterpret_cast<uint64_t>(paths[first + j].c_str());
+      sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    }
+    bool unsupported = false;
+    if (!ring.run([&](uint64_t j, int res) {
+          fds[j] = res;
+          unsupported |= res == -EINVAL;
+        }) ||
+        unsupported) {
+      /* Either the ring failed, or the kernel has no IORING_OP_OPENAT/READ
+       * (before 5.6). */
+      closeOpen(count);
+      return first;
+    }
+
+    for (unsigned j = 0; j < count; ++j) {
+      lengths[j] = -1;
+      if (fds[j] >= 0) {
+        io_uring_sqe *sqe = ring.next(IORING_OP_READ, j);
+        sqe->fd = fds[j];
+        sqe->addr = reinterpret_cast<uint64_t>(slots.get() + j * BatchReader::SLOT_SIZE);
+        sqe->len = static_cast<uint32_t>(BatchReader::SLOT_SIZE);
+        sqe->off = 0;
+      }
+    }
+    if (!ring.run([&](uint64_t j, int res) { lengths[j] = res; })) {
+      closeOpen(count);
+      return first;
+    }
+
+    for (unsigned j = 0; j < count; ++j) {
+      if (fds[j] < 0 || lengths[j] < 0) {
+        continue;
+      }
+      const char *slot = slots.get() + j * BatchReader::SLOT_SIZE;
+      const size_t len = static_cast<size_t>(lengths[j]);
+      if (len < BatchReader::SLOT_SIZE) {
+        onFile(first + j, string_view(slot, len));
+      } else {
+        contents.assign(slot, len);
+        if (preadRest(fds[j], static_cast<off_t>(len), contents)) {
+          onFile(first + j, contents);
+        }
+      }
+    }
+
+    for (unsigned j = 0; j < count; ++j) {
+      if (fds[j] >= 0) {
+        ring.next(IORING_OP_CLOSE, j)->fd = fds[j];
+      }
+    }
+    /* Completed closes are forgotten; the rest, whether the kernel has no
+     * IORING_OP_CLOSE or the ring failed before taking them, are closed
+     * here. run() has reaped every close it submitted by now. */
+    const bool closed = ring.run([&](uint64_t j, int res) {
+      if (res != -EINVAL) {
+        fds[j] = -1;
+      }
+    });
+    closeOpen(count);
+    if (!closed) {
+      return first + count;
+    }
+  }
+  return paths.size();
+}
+
+}  // namespace
+#endif
+
+bool BatchReader::ioUringAvailable() {
+#ifdef AARCHUP_HAVE_IO_URING
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  const int fd = static_cast<int>(syscall(__NR_io_uring_setup, 1, &params));
+  if (fd >= 0) {
+    close(fd);
+    return true;
+  }
+#endif
+  return false;
+}
+
+BatchReader::Method BatchReader::readAll(int dirfd, const vector<string> &paths,
+                                         Method method,
+                                         const FileHandler &onFile) {
+  size_t done = 0;
+#ifdef AARCHUP_HAVE_IO_URING
+  if (method != Method::Pread) {
+    done = readAllIoUring(dirfd, paths, onFile);
+    if (done == paths.size()) {
+      return Method::IoUring;
+    }
+  }
+#else
+  (void)method;
+#endif
+  readAllPread(dirfd, paths, onFile, done);
+  return Method::Pread;
+}
@@ -0,0 +1,35 @@
+#ifndef AARCHUP_BATCHREADER_H
+#define AARCHUP_BATCHREADER_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Reads many small files below one directory. With io_uring the opens,
+ * reads and closes of a few hundred files go to the kernel as one batch
+ * each instead of one syscall per step per file; otherwise every file is
+ * opened and pread in turn. */
+class BatchReader {
+ public:
+  enum class Method { Auto, IoUring, Pread };
+
+  /* Receives the index into paths and the file's contents. Files that
+   * can't be read are skipped. */
+  typedef std::function<void(size_t, std::string_view)> FileHandler;
+
+  static const unsigned BATCH = 256;
+  /* Per-file read size of the io_uring path; longer files are finished
+   * with pread. */
+  static const size_t SLOT_SIZE = 8 * 1024;
+
+  /* Reads dirfd/paths[i] for every i. Returns the method actually used;
+   * Auto and IoUring fall back to Pread when io_uring is unavailable. */
+  static Method readAll(int dirfd, const std::vector<std::string> &paths,
+                        Method method, const FileHandler &onFile);
+
+  static bool ioUringAvailable();
+};
+
+#endif
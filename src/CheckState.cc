@@ -0,0 +1,80 @@
+#include "CheckState.hh"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+const char *const CheckState::FILE_NAME = "state";
+
+static const char STATE_VERSION[] = "aarchup-state 1";
+
+CheckState CheckState::load(const string &path) {
+  CheckState state;
+  ifstream in(path);
+  string line;
+  if (!getline(in, line) || line != STATE_VERSION) {
+    return state;
+  }
+  while (getline(in, line)) {
+    istringstream fields(line);
+    string key;
+    if (!(fields >> key)) {
+      continue;
+    }
+    if (key == "fingerprint") {
+      fields >> hex >> state.fingerprint;
+    } else if (key == "notification") {
+      fields >> state.notificationId;
+    }
+    if (fields.fail()) {
+      return CheckState();
+    }
+  }
+  return state;
+}
+
+bool CheckState::save(const string &path) const {
+  ostringstream out;
+  out << STATE_VERSION << '\n'
+      << "fingerprint " << hex << fingerprint << dec << '\n'
+      << "notification " << notificationId << '\n';
+  const string text = out.str();
+
+  /* Write aside and rename; the temporary name is unique, so two
+   * instances saving at once never write into the same file. */
+  string tmpPath = path + ".XXXXXX";
+  const int fd = mkostemp(&tmpPath[0], O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  fchmod(fd, 0644);
+  FILE *file = fdopen(fd, "w");
+  if (!file) {
+    close(fd);
+    unlink(tmpPath.c_str());
+    return false;
+  }
+  const bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+  if (fclose(file) != 0 || !written ||
+      rename(tmpPath.c_str(), path.c_str()) != 0) {
+    unlink(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+uint64_t CheckState::fingerprintOf(string_view text) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const char c : text) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  /* 0 means "nothing shown", keep it out of the hash range. */
+  return hash == 0 && !text.empty() ? 1 : hash;
+}
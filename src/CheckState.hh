@@ -0,0 +1,28 @@
+#ifndef AARCHUP_CHECKSTATE_H
+#define AARCHUP_CHECKSTATE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/* What the previous run showed, kept in $XDG_STATE_HOME/aarchup/state so a
+ * fresh process (the systemd timer) can tell whether anything changed. */
+struct CheckState {
+  static const char *const FILE_NAME;
+
+  /* fingerprint() of the last notification body, 0 when none was shown. */
+  uint64_t fingerprint = 0;
+  /* Id the notification server gave that notification, 0 if unknown. */
+  uint32_t notificationId = 0;
+
+  /* A missing or unreadable file gives the empty state. */
+  static CheckState load(const std::string &path);
+
+  /* Writes aside and renames over path. Returns false on failure. */
+  bool save(const std::string &path) const;
+
+  /* 64-bit FNV-1a of text; never 0 for a non-empty text. */
+  static uint64_t fingerprintOf(std::string_view text);
+};
+
+#endif
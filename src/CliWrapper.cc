@@ -1,30 +1,478 @@
 #include "CliWrapper.hh"
 
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <sstream>
+
+extern char **environ;
+
 using namespace std;
 
-CliWrapper::CliWrapper(const char *cliCommand) {
-  this->_cliCommand = cliCommand;
+const size_t CliWrapper::DEFAULT_MAX_OUTPUT;
+const size_t CliWrapper::READ_CHUNK;
+
+CliOutput::CliOutput(CliOutput &&other) noexcept
+    : _buffer(std::move(other._buffer)),
+      _map(other._map),
+      _mapSize(other._mapSize) {
+  other._map = nullptr;
+  other._mapSize = 0;
+}
+
+CliOutput &CliOutput::operator=(CliOutput &&other) noexcept {
+  if (this != &other) {
+    release();
+    _buffer = std::move(other._buffer);
+    _map = other._map;
+    _mapSize = other._mapSize;
+    other._map = nullptr;
+    other._mapSize = 0;
+  }
+  return *this;
+}
+
+CliOutput::~CliOutput() { release(); }
+
+void CliOutput::assign(string &&buffer) {
+  release();
+  _buffer = std::move(buffer);
+}
+
+void CliOutput::map(int fd, size_t size) {
+  release();
+  if (size == 0) {
+    return;
+  }
+  void *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    std::stringstream ss;
+    ss << "Failed to map captured output: " << strerror(errno);
+    throw std::runtime_error(ss.str());
+  }
+  _map = addr;
+  _mapSize = size;
+}
+
+const char *CliOutput::data() const {
+  return _map ? static_cast<const char *>(_map) : _buffer.data();
+}
+
+size_t CliOutput::size() const { return _map ? _mapSize : _buffer.size(); }
+
+void CliOutput::release() {
+  if (_map) {
+    munmap(_map, _mapSize);
+    _map = nullptr;
+    _mapSize = 0;
+  }
+  _buffer.clear();
+}
+
+CliWrapper::CliWrapper(const char *cliCommand)
+    : _argv(splitArgs(cliCommand)),
+      _maxOutput(DEFAULT_MAX_OUTPUT),
+      _useMemfd(false),
+      _timeout(0),
+      _running(0),
+      _cancelled(false) {
+  if (_argv.empty()) {
+    throw std::runtime_error("Empty command given");
+  }
 }
 
 CliWrapper::~CliWrapper() = default;
 
-string CliWrapper::execute() {
-  shared_ptr<FILE> pipe(popen(CliWrapper::_cliCommand, "r"), pclose);
-  if (!pipe) {
+CliResult CliWrapper::execute() {
+  return _useMemfd ? executeMemfd(nullptr) : executePipe(nullptr);
+}
+
+CliResult CliWrapper::execute(const LineSplitter::LineHandler &onLine) {
+  LineSplitter splitter(onLine);
+  CliResult result =
+      _useMemfd ? executeMemfd(&splitter) : executePipe(&splitter);
+  if (!result.timedOut) {
+    splitter.finish();
+    result.skippedLines = splitter.skipped();
+  }
+  return result;
+}
+
+void CliWrapper::cancel() {
+  /* spawn() publishes the child before it looks at _cancelled, so either
+   * it kills a child started now or this sees it. */
+  _cancelled = true;
+  const pid_t pid = _running;
+  if (pid > 0) {
+    kill(-pid, SIGKILL);
+  }
+}
+
+vector<string> CliWrapper::splitArgs(const char *cliCommand) {
+  vector<string> args;
+  string current;
+  bool inArg = false;
+  char quote = 0;
+  for (const char *p = cliCommand; p && *p; ++p) {
+    const char c = *p;
+    if (quote) {
+      if (c == quote) {
+        quote = 0;
+      } else if (c == '\\' && quote == '"' && p[1]) {
+        current += *++p;
+      } else {
+        current += c;
+      }
+    } else if (c == '\'' || c == '"') {
+      quote = c;
+      inArg = true;
+    } else if (c == '\\' && p[1]) {
+      current += *++p;
+      inArg = true;
+    } else if (isspace(static_cast<unsigned char>(c))) {
+      if (inArg) {
+        args.push_back(current);
+        current.clear();
+        inArg = false;
+      }
+    } else {
+      current += c;
+      inArg = true;
+    }
+  }
+  if (quote) {
     std::stringstream ss;
-    ss << "Failed to execute command " << _cliCommand;
+    ss << "Unterminated quote in command " << cliCommand;
     throw std::runtime_error(ss.str());
   }
-  return parseOutput(pipe);
+  if (inArg) {
+    args.push_back(current);
+  }
+  return args;
 }
 
-string CliWrapper::parseOutput(const shared_ptr<FILE> &pipe) const {
-  array<char, 128> buffer = {0};
-  string result;
-  while (!feof(pipe.get())) {
-    if (fgets(buffer.data(), 128, pipe.get()) != nullptr) {
-      result += buffer.data();
+bool CliWrapper::looksLikeShell(const char *cliCommand) {
+  static const char *const operators[] = {"|", "||", "&", "&&", ";"};
+  vector<string> args;
+  try {
+    args = splitArgs(cliCommand);
+  } catch (const std::runtime_error &) {
+    return false;
+  }
+  if (args.empty()) {
+    return false;
+  }
+  /* sh -c '...' already has its shell. */
+  const string &program = args[0];
+  const string name = program.substr(program.rfind('/') + 1);
+  if (name == "sh" || name == "bash" || name == "dash" || name == "zsh") {
+    return false;
+  }
+  /* VAR=value command */
+  const size_t eq = program.find('=');
+  if (eq != string::npos && eq > 0 && program.find('/') > eq) {
+    return true;
+  }
+  for (const string &arg : args) {
+    for (const char *op : operators) {
+      if (arg == op) {
+        return true;
+      }
     }
+    if (arg[0] == '<' || arg[0] == '>' || arg.compare(0, 2, "2>") == 0 ||
+        arg.compare(0, 2, "&>") == 0 || arg.find('`') != string::npos ||
+        arg.find("$(") != string::npos) {
+      return true;
+    }
+  }
+  return false;
+}
+
+pid_t CliWrapper::spawn(int stdoutFd) {
+  if (_cancelled) {
+    std::stringstream ss;
+    ss << "Command " << _argv[0] << " cancelled";
+    throw std::runtime_error(ss.str());
+  }
+  vector<char *> &argv = _spawnArgv;
+  argv.clear();
+  for (const auto &arg : _argv) {
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, stdoutFd, STDOUT_FILENO);
+
+  /* Each backend leads its own process group so a timeout can take down
+   * everything it started, e.g. checkupdates' fakeroot and pacman. */
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+  posix_spawnattr_setpgroup(&attr, 0);
+
+  pid_t pid;
+  const int err =
+      posix_spawnp(&pid, argv[0], &actions, &attr, argv.data(), environ);
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  if (err != 0) {
+    std::stringstream ss;
+    ss << "Failed to execute command " << _argv[0] << ": " << strerror(err);
+    throw std::runtime_error(ss.str());
+  }
+  _running = pid;
+  if (_cancelled) {
+    kill(-pid, SIGKILL);
+  }
+  return pid;
+}
+
+/* Milliseconds left until the deadline, -1 for none, 0 if it has passed. */
+static int remainingMs(const CliWrapper::Deadline *deadline) {
+  if (!deadline) {
+    return -1;
+  }
+  const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+      *deadline - std::chrono::steady_clock::now());
+  if (left.count() <= 0) {
+    return 0;
+  }
+  return static_cast<int>(min<long long>(left.count(), 24 * 3600 * 1000));
+}
+
+bool CliWrapper::waitReadable(int fd, const Deadline *deadline) {
+  pollfd pfd = {fd, POLLIN, 0};
+  while (true) {
+    const int ready = poll(&pfd, 1, remainingMs(deadline));
+    if (ready > 0) {
+      return true;
+    }
+    if (ready == 0) {
+      return false;
+    }
+    if (errno != EINTR) {
+      return true; /* let read() report the error */
+    }
+  }
+}
+
+int CliWrapper::waitExit(pid_t pid, const Deadline *deadline, bool *timedOut) {
+  int status;
+  if (deadline) {
+    /* A pidfd becomes readable when the child exits; kernels without
+     * pidfd_open get a short polling loop instead. */
+    int pidfd = -1;
+#ifdef SYS_pidfd_open
+    pidfd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#endif
+    if (pidfd >= 0) {
+      const bool exited = waitReadable(pidfd, deadline);
+      close(pidfd);
+      if (!exited) {
+        *timedOut = true;
+        return killGroup(pid);
+      }
+    } else {
+      pid_t reaped;
+      while ((reaped = waitpid(pid, &status, WNOHANG)) == 0) {
+        if (remainingMs(deadline) == 0) {
+          *timedOut = true;
+          return killGroup(pid);
+        }
+        const timespec tick = {0, 10 * 1000 * 1000};
+        nanosleep(&tick, nullptr);
+      }
+      if (reaped == pid) {
+        return decodeStatus(status);
+      }
+    }
+  }
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      return -1;
+    }
+  }
+  return decodeStatus(status);
+}
+
+int CliWrapper::killGroup(pid_t pid) {
+  kill(-pid, SIGKILL);
+  return waitExit(pid, nullptr, nullptr);
+}
+
+int CliWrapper::decodeStatus(int status) {
+  if (WIFEXITED(status)) {
+    return WEXITSTATUS(status);
+  }
+  if (WIFSIGNALED(status)) {
+    return 128 + WTERMSIG(status);
+  }
+  return -1;
+}
+
+CliWrapper::ReadStatus CliWrapper::parseOutput(int fd, string &result,
+                                               size_t maxOutput,
+                                               const Deadline *deadline) {
+  while (result.size() < maxOutput) {
+    if (deadline && !waitReadable(fd, deadline)) {
+      return ReadStatus::TimedOut;
+    }
+    const size_t chunk = min(READ_CHUNK, maxOutput - result.size());
+    const size_t used = result.size();
+    result.resize(used + chunk);
+    const ssize_t n = read(fd, &result[used], chunk);
+    if (n <= 0) {
+      result.resize(used);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      return ReadStatus::Eof;
+    }
+    result.resize(used + static_cast<size_t>(n));
+  }
+  /* Limit reached; one more byte tells a runaway child apart from output
+   * that ended exactly at the limit. */
+  if (deadline && !waitReadable(fd, deadline)) {
+    return ReadStatus::TimedOut;
+  }
+  char probe;
+  ssize_t n;
+  do {
+    n = read(fd, &probe, 1);
+  } while (n < 0 && errno == EINTR);
+  return n > 0 ? ReadStatus::Truncated : ReadStatus::Eof;
+}
+
+CliWrapper::ReadStatus CliWrapper::streamOutput(int fd, LineSplitter &splitter,
+                                                size_t maxOutput,
+                                                size_t &bytesRead,
+                                                const Deadline *deadline) {
+  char chunk[READ_CHUNK];
+  size_t &total = bytesRead;
+  while (true) {
+    if (deadline && !waitReadable(fd, deadline)) {
+      return ReadStatus::TimedOut;
+    }
+    const ssize_t n = read(fd, chunk, sizeof(chunk));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return ReadStatus::Eof;
+    }
+    const size_t len = min(static_cast<size_t>(n), maxOutput - total);
+    splitter.feed(chunk, len);
+    total += len;
+    if (len < static_cast<size_t>(n)) {
+      return ReadStatus::Truncated;
+    }
+  }
+}
+
+CliResult CliWrapper::executePipe(LineSplitter *splitter) {
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) != 0) {
+    std::stringstream ss;
+    ss << "Failed to create pipe for command " << _argv[0];
+    throw std::runtime_error(ss.str());
+  }
+  pid_t pid;
+  try {
+    pid = spawn(fds[1]);
+  } catch (...) {
+    close(fds[0]);
+    close(fds[1]);
+    throw;
+  }
+  close(fds[1]);
+
+  const Deadline deadline = std::chrono::steady_clock::now() + _timeout;
+  const Deadline *limit = _timeout.count() > 0 ? &deadline : nullptr;
+
+  CliResult result;
+  string buffer;
+  ReadStatus status;
+  if (splitter) {
+    status = streamOutput(fds[0], *splitter, _maxOutput, result.bytesRead,
+                          limit);
+  } else {
+    buffer.reserve(READ_CHUNK);
+    status = parseOutput(fds[0], buffer, _maxOutput, limit);
+    result.bytesRead = buffer.size();
+  }
+  /* Closing our end makes a child that is still writing fail with EPIPE
+   * instead of blocking forever on a full pipe. */
+  close(fds[0]);
+  if (status == ReadStatus::TimedOut) {
+    result.timedOut = true;
+    result.exitStatus = killGroup(pid);
+  } else {
+    result.truncated = status == ReadStatus::Truncated;
+    result.exitStatus = waitExit(pid, limit, &result.timedOut);
+  }
+  _running = 0;
+  result.output.assign(std::move(buffer));
+  return result;
+}
+
+CliResult CliWrapper::executeMemfd(LineSplitter *splitter) {
+  const int fd = memfd_create("aarchup-capture", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0) {
+    std::stringstream ss;
+    ss << "Failed to create capture memfd: " << strerror(errno);
+    throw std::runtime_error(ss.str());
+  }
+  /* Size the file to the limit and forbid growth, so writes past the limit
+   * fail in the child rather than consuming our memory. The extra chunk of
+   * slack lets us notice that the child went over the limit. */
+  if (ftruncate(fd, static_cast<off_t>(_maxOutput + READ_CHUNK)) != 0 ||
+      fcntl(fd, F_ADD_SEALS, F_SEAL_GROW | F_SEAL_SHRINK) != 0) {
+    close(fd);
+    std::stringstream ss;
+    ss << "Failed to prepare capture memfd: " << strerror(errno);
+    throw std::runtime_error(ss.str());
+  }
+  pid_t pid;
+  try {
+    pid = spawn(fd);
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+
+  const Deadline deadline = std::chrono::steady_clock::now() + _timeout;
+  const Deadline *limit = _timeout.count() > 0 ? &deadline : nullptr;
+
+  CliResult result;
+  result.exitStatus = waitExit(pid, limit, &result.timedOut);
+  _running = 0;
+  /* The child shared our file description, so its offset is the number of
+   * bytes it managed to write. */
+  const off_t written = lseek(fd, 0, SEEK_CUR);
+  const size_t size = written > 0 ? static_cast<size_t>(written) : 0;
+  result.truncated = size > _maxOutput;
+  result.bytesRead = min(size, _maxOutput);
+  try {
+    result.output.map(fd, min(size, _maxOutput));
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+  close(fd);
+  if (splitter && !result.timedOut) {
+    splitter->feed(result.output.data(), result.output.size());
+    result.output = CliOutput();
   }
   return result;
 }
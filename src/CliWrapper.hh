@@ -1,25 +1,133 @@
 #ifndef AARCHUP_CLIWRAPPER_H
 #define AARCHUP_CLIWRAPPER_H
 
-#include <array>
-#include <cstdio>
-#include <iostream>
-#include <memory>
-#include <sstream>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <stdexcept>
 #include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "LineSplitter.hh"
+
+/* Output captured from a backend, either read from a pipe into a heap buffer
+ * or mapped read-only from the memfd the child wrote to. */
+class CliOutput {
+  std::string _buffer;
+  void *_map = nullptr;
+  size_t _mapSize = 0;
+
+ public:
+  CliOutput() = default;
+  CliOutput(const CliOutput &) = delete;
+  CliOutput &operator=(const CliOutput &) = delete;
+  CliOutput(CliOutput &&other) noexcept;
+  CliOutput &operator=(CliOutput &&other) noexcept;
+  ~CliOutput();
+
+  void assign(std::string &&buffer);
+  void map(int fd, size_t size);
+
+  const char *data() const;
+  size_t size() const;
+  bool empty() const { return size() == 0; }
+  std::string str() const { return std::string(data(), size()); }
+
+ private:
+  void release();
+};
+
+struct CliResult {
+  /* Exit code of the child, or 128 + signal number if it was killed. */
+  int exitStatus = -1;
+  /* Bytes taken from the child's stdout, up to the capture limit. */
+  size_t bytesRead = 0;
+  /* True when the child produced more than the capture limit. */
+  bool truncated = false;
+  /* True when the child's process group was killed at the deadline. */
+  bool timedOut = false;
+  /* Lines counted but not handed out after the line handler stopped. */
+  size_t skippedLines = 0;
+  CliOutput output;
+};
 
 class CliWrapper {
-  const char *_cliCommand;
+  std::vector<std::string> _argv;
+  /* _argv as posix_spawn() wants it, rebuilt in place for every run. */
+  mutable std::vector<char *> _spawnArgv;
+  size_t _maxOutput;
+  bool _useMemfd;
+  std::chrono::milliseconds _timeout;
+  /* The child of the running execute(), 0 while none runs. */
+  std::atomic<pid_t> _running;
+  std::atomic<bool> _cancelled;
 
  public:
+  typedef std::chrono::steady_clock::time_point Deadline;
+
+  enum class ReadStatus { Eof, Truncated, TimedOut };
+
+  static const size_t DEFAULT_MAX_OUTPUT = 4 * 1024 * 1024;
+  static const size_t READ_CHUNK = 64 * 1024;
+
   CliWrapper(const char *cliCommand);
 
-  std::string execute();
+  /* Caps the number of bytes kept from the child's stdout. */
+  void setMaxOutput(size_t maxOutput) { _maxOutput = maxOutput; }
+  size_t maxOutput() const { return _maxOutput; }
+
+  /* Lets the child write straight into a sealed memfd instead of a pipe. */
+  void setUseMemfd(bool useMemfd) { _useMemfd = useMemfd; }
+
+  /* Kills the child's whole process group if it runs longer than timeout.
+   * A zero timeout waits forever. */
+  void setTimeout(std::chrono::milliseconds timeout) { _timeout = timeout; }
+
+  /* Throws std::runtime_error if the command can't be started or the
+   * wrapper was cancelled. */
+  CliResult execute();
+
+  /* Runs the command and hands its stdout to onLine line by line as it
+   * arrives instead of keeping it; the returned output stays empty. Lines
+   * after onLine returned false are only counted, in skippedLines. */
+  CliResult execute(const LineSplitter::LineHandler &onLine);
+
+  /* Kills the process group of a running execute(), which then returns as
+   * if the child was killed, and makes later ones throw. Safe to call from
+   * any thread. */
+  void cancel();
 
   virtual ~CliWrapper();
 
-  std::string parseOutput(const std::shared_ptr<FILE> &pipe) const;
+  /* Reads fd until EOF, until maxOutput bytes were kept or until the
+   * deadline passes. A null deadline blocks until one of the others. */
+  static ReadStatus parseOutput(int fd, std::string &result, size_t maxOutput,
+                                const Deadline *deadline = nullptr);
+
+  /* Same as parseOutput but feeds the bytes to splitter through a fixed
+   * chunk buffer. Once the splitter is done the rest is only counted. */
+  static ReadStatus streamOutput(int fd, LineSplitter &splitter,
+                                 size_t maxOutput, size_t &bytesRead,
+                                 const Deadline *deadline = nullptr);
+
+  /* Splits a command line on whitespace, honouring single and double quotes
+   * and backslash escapes; no other shell syntax is interpreted. */
+  static std::vector<std::string> splitArgs(const char *cliCommand);
+
+  /* True if cliCommand has pipes, redirections, command lists or leading
+   * variable assignments, which only a shell would have understood. */
+  static bool looksLikeShell(const char *cliCommand);
+
+ private:
+  pid_t spawn(int stdoutFd);
+  static bool waitReadable(int fd, const Deadline *deadline);
+  static int waitExit(pid_t pid, const Deadline *deadline, bool *timedOut);
+  static int killGroup(pid_t pid);
+  static int decodeStatus(int status);
+  CliResult executePipe(LineSplitter *splitter);
+  CliResult executeMemfd(LineSplitter *splitter);
 };
 
 #endif
@@ -0,0 +1,44 @@
+#include "LineBuffer.hh"
+
+#include <string.h>
+
+using namespace std;
+
+const size_t LineBuffer::BYTES_PER_LINE;
+
+LineBuffer::LineBuffer(long maxLines, pmr::memory_resource *resource)
+    : _text(resource),
+      _maxLines(maxLines > 0 ? maxLines : 0),
+      _lines(0),
+      _seen(0) {
+  _text.reserve(static_cast<size_t>(_maxLines) * BYTES_PER_LINE);
+}
+
+bool LineBuffer::addLine(string_view line) {
+  ++_seen;
+  if (full()) {
+    return false;
+  }
+  _text.append(line.data(), line.size());
+  _text.push_back('\n');
+  ++_lines;
+  return !full();
+}
+
+bool LineBuffer::append(const LineBuffer &other) {
+  const char *data = other._text.data();
+  const char *end = data + other._text.size();
+  while (data < end && !full()) {
+    const auto *nl =
+        static_cast<const char *>(memchr(data, '\n', static_cast<size_t>(end - data)));
+    addLine(string_view(data, static_cast<size_t>(nl - data)));
+    data = nl + 1;
+  }
+  return !full();
+}
+
+void LineBuffer::clear() {
+  _text.clear();
+  _lines = 0;
+  _seen = 0;
+}
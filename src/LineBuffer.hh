@@ -0,0 +1,41 @@
+#ifndef AARCHUP_LINEBUFFER_H
+#define AARCHUP_LINEBUFFER_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+/* Keeps up to maxLines lines, each terminated by '\n', in one buffer that is
+ * allocated up front from resource. Lines offered after that are only
+ * counted. */
+class LineBuffer {
+  std::pmr::string _text;
+  long _maxLines;
+  long _lines;
+  long _seen;
+
+ public:
+  static const size_t BYTES_PER_LINE = 80;
+
+  explicit LineBuffer(long maxLines, std::pmr::memory_resource *resource =
+                                         std::pmr::get_default_resource());
+
+  /* Returns false once the buffer is full. */
+  bool addLine(std::string_view line);
+
+  /* Adds the lines of other until this buffer is full. */
+  bool append(const LineBuffer &other);
+
+  /* Forgets the lines but keeps the buffer. */
+  void clear();
+
+  bool full() const { return _lines >= _maxLines; }
+  bool empty() const { return _seen == 0; }
+  long lines() const { return _lines; }
+  long seen() const { return _seen; }
+  const std::pmr::string &str() const { return _text; }
+  const char *c_str() const { return _text.c_str(); }
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include "LineSplitter.hh"
+
+#include <string.h>
+#include <cstdint>
+#include <utility>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+LineSplitter::LineSplitter(LineHandler onLine)
+    : _onLine(std::move(onLine)), _done(false), _skipped(0), _partial(false) {}
+
+bool LineSplitter::feed(const char *data, size_t size) {
+  const char *end = data + size;
+  while (!_done && data < end) {
+    const auto *nl =
+        static_cast<const char *>(memchr(data, '\n', static_cast<size_t>(end - data)));
+    if (!nl) {
+      _carry.append(data, static_cast<size_t>(end - data));
+      break;
+    }
+    if (_carry.empty()) {
+      _done = !_onLine(string_view(data, static_cast<size_t>(nl - data)));
+    } else {
+      _carry.append(data, static_cast<size_t>(nl - data));
+      _done = !_onLine(string_view(_carry));
+      _carry.clear();
+    }
+    data = nl + 1;
+  }
+  if (_done && data < end) {
+    _skipped += countLines(data, static_cast<size_t>(end - data));
+    _partial = end[-1] != '\n';
+  }
+  return !_done;
+}
+
+void LineSplitter::finish() {
+  if (!_done && !_carry.empty()) {
+    _done = !_onLine(string_view(_carry));
+  } else if (_done && _partial) {
+    ++_skipped;
+    _partial = false;
+  }
+  _carry.clear();
+}
+
+size_t LineSplitter::countLines(const char *data, size_t size) {
+  size_t count = 0;
+  size_t i = 0;
+#ifdef __SSE2__
+  const __m128i newline = _mm_set1_epi8('\n');
+  for (; i + 16 <= size; i += 16) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    count += static_cast<size_t>(__builtin_popcount(
+        static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)))));
+  }
+#else
+  /* SWAR: a byte of x is zero exactly where the word had a '\n'. */
+  const uint64_t lows = 0x7f7f7f7f7f7f7f7fULL;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    memcpy(&word, data + i, 8);
+    const uint64_t x = word ^ 0x0a0a0a0a0a0a0a0aULL;
+    const uint64_t zero = ~(((x & lows) + lows) | x | lows);
+    count += static_cast<size_t>(__builtin_popcountll(zero));
+  }
+#endif
+  for (; i < size; ++i) {
+    count += data[i] == '\n';
+  }
+  return count;
+}
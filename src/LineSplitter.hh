@@ -0,0 +1,44 @@
+#ifndef AARCHUP_LINESPLITTER_H
+#define AARCHUP_LINESPLITTER_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/* Cuts a byte stream into lines as chunks arrive. Complete lines are handed
+ * out as views into the chunk itself; only a line that straddles two chunks
+ * is copied into the carry buffer. Once the handler stopped, the rest of
+ * the stream is only counted. */
+class LineSplitter {
+ public:
+  /* Receives each line without its '\n'. Returning false stops the
+   * splitter from producing further lines. */
+  typedef std::function<bool(std::string_view)> LineHandler;
+
+ private:
+  LineHandler _onLine;
+  std::string _carry;
+  bool _done;
+  size_t _skipped;
+  bool _partial;
+
+ public:
+  explicit LineSplitter(LineHandler onLine);
+
+  /* Returns false once the handler asked to stop. */
+  bool feed(const char *data, size_t size);
+
+  /* Flushes a final line that was not terminated by '\n'. */
+  void finish();
+
+  bool done() const { return _done; }
+
+  /* Lines fed after the handler stopped. */
+  size_t skipped() const { return _skipped; }
+
+  /* Number of '\n' in data, 16 bytes at a time. */
+  static size_t countLines(const char *data, size_t size);
+};
+
+#endif
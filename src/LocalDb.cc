@@ -0,0 +1,194 @@
+#include "LocalDb.hh"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const char CACHE_MAGIC[8] = {'A', 'A', 'R', 'L', 'I', 'D', 'X', '1'};
+
+/* Followed by count PackageEntry records and poolSize bytes of pool. */
+struct CacheHeader {
+  char magic[8];
+  uint64_t dev;
+  uint64_t ino;
+  int64_t mtimeSec;
+  int64_t mtimeNsec;
+  uint64_t count;
+  uint64_t poolSize;
+};
+
+bool sameDir(const CacheHeader &header, const struct stat &dirStat) {
+  return header.dev == static_cast<uint64_t>(dirStat.st_dev) &&
+         header.ino == static_cast<uint64_t>(dirStat.st_ino) &&
+         header.mtimeSec == static_cast<int64_t>(dirStat.st_mtim.tv_sec) &&
+         header.mtimeNsec == static_cast<int64_t>(dirStat.st_mtim.tv_nsec);
+}
+
+bool writeAll(int fd, const void *data, size_t size) {
+  const char *p = static_cast<const char *>(data);
+  while (size > 0) {
+    const ssize_t n = write(fd, p, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+}  // namespace
+
+LocalDb::~LocalDb() { unmap(); }
+
+void LocalDb::unmap() {
+  if (_map) {
+    munmap(_map, _mapSize);
+    _map = nullptr;
+    _mapSize = 0;
+  }
+}
+
+bool LocalDb::open(const string &dir, const string &cachePath) {
+  unmap();
+  _table.clear();
+  struct stat dirStat;
+  if (stat(dir.c_str(), &dirStat) != 0) {
+    std::stringstream ss;
+    ss << "Failed to open local database " << dir << ": " << strerror(errno);
+    throw std::runtime_error(ss.str());
+  }
+  if (!cachePath.empty() && mapCache(cachePath, dirStat)) {
+    return true;
+  }
+  /* Stat before reading: if a transaction runs meanwhile the cache is
+   * written with the old mtime and simply rebuilt next time. */
+  load(dir, _table);
+  _view = _table.view();
+  if (!cachePath.empty()) {
+    writeCache(cachePath, dirStat, _table);
+  }
+  return false;
+}
+
+bool LocalDb::mapCache(const string &cachePath, const struct stat &dirStat) {
+  const int fd = ::open(cachePath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat cacheStat;
+  void *map = MAP_FAILED;
+  if (fstat(fd, &cacheStat) == 0 &&
+      static_cast<size_t>(cacheStat.st_size) >= sizeof(CacheHeader)) {
+    map = mmap(nullptr, static_cast<size_t>(cacheStat.st_size), PROT_READ,
+               MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  _map = map;
+  _mapSize = static_cast<size_t>(cacheStat.st_size);
+
+  CacheHeader header;
+  memcpy(&header, _map, sizeof(header));
+  const size_t entriesSize = header.count * sizeof(PackageEntry);
+  if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+      !sameDir(header, dirStat) || header.count > _mapSize ||
+      sizeof(header) + entriesSize + header.poolSize != _mapSize) {
+    unmap();
+    return false;
+  }
+  const char *base = static_cast<const char *>(_map);
+  const auto *entries =
+      reinterpret_cast<const PackageEntry *>(base + sizeof(header));
+  const char *pool = base + sizeof(header) + entriesSize;
+  for (size_t i = 0; i < header.count; ++i) {
+    const PackageEntry &e = entries[i];
+    if (e.name + uint64_t(e.nameLen) > header.poolSize ||
+        e.version + uint64_t(e.versionLen) > header.poolSize) {
+      unmap();
+      return false;
+    }
+  }
+  _view = PackageView(entries, header.count, pool);
+  return true;
+}
+
+bool LocalDb::writeCache(const string &cachePath, const struct stat &dirStat,
+                         const PackageTable &table) {
+  CacheHeader header;
+  memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  header.dev = static_cast<uint64_t>(dirStat.st_dev);
+  header.ino = static_cast<uint64_t>(dirStat.st_ino);
+  header.mtimeSec = static_cast<int64_t>(dirStat.st_mtim.tv_sec);
+  header.mtimeNsec = static_cast<int64_t>(dirStat.st_mtim.tv_nsec);
+  header.count = table.size();
+  header.poolSize = table.pool().size();
+
+  /* Write aside and rename, so a reader never maps a half written file.
+   * The temporary name is unique, two writers never share it. */
+  string tmpPath = cachePath + ".XXXXXX";
+  const int fd = mkostemp(&tmpPath[0], O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  fchmod(fd, 0644);
+  const bool written =
+      writeAll(fd, &header, sizeof(header)) &&
+      writeAll(fd, table.entries().data(),
+               table.entries().size() * sizeof(PackageEntry)) &&
+      writeAll(fd, table.pool().data(), table.pool().size());
+  if (close(fd) != 0 || !written ||
+      rename(tmpPath.c_str(), cachePath.c_str()) != 0) {
+    unlink(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+BatchReader::Method LocalDb::load(const string &dir, PackageTable &table,
+                                  BatchReader::Method method) {
+  unique_ptr<DIR, int (*)(DIR *)> handle(opendir(dir.c_str()), closedir);
+  if (!handle) {
+    std::stringstream ss;
+    ss << "Failed to open local database " << dir << ": " << strerror(errno);
+    throw std::runtime_error(ss.str());
+  }
+  vector<string> paths;
+  while (const dirent *entry = readdir(handle.get())) {
+    if (entry->d_name[0] == '.' || entry->d_type == DT_REG) {
+      continue; /* ".", ".." and ALPM_DB_VERSION */
+    }
+    paths.emplace_back(entry->d_name);
+    paths.back() += "/desc";
+  }
+  table.reserve(paths.size(), paths.size() * 32);
+  const BatchReader::Method used = BatchReader::readAll(
+      ::dirfd(handle.get()), paths, method,
+      [&table](size_t, string_view desc) {
+        string_view name, version;
+        if (parseDesc(desc, name, version)) {
+          table.add(name, version);
+        }
+      });
+  table.sortByName();
+  return used;
+}
@@ -0,0 +1,54 @@
+#ifndef AARCHUP_LOCALDB_H
+#define AARCHUP_LOCALDB_H
+
+#include <cstddef>
+#include <string>
+
+#include <sys/stat.h>
+
+#include "BatchReader.hh"
+#include "PackageTable.hh"
+
+/* The installed packages from pacman's local database, one
+ * <pkg>-<ver>/desc file per package.
+ *
+ * Walking thousands of directories on every check is the expensive part, so
+ * the sorted index is persisted to a cache file and mapped back in on the
+ * next run. The cache is tied to the local directory's identity and mtime,
+ * which pacman bumps whenever a transaction adds or removes a package. */
+class LocalDb {
+  PackageTable _table;
+  void *_map = nullptr;
+  size_t _mapSize = 0;
+  PackageView _view;
+
+ public:
+  LocalDb() = default;
+  LocalDb(const LocalDb &) = delete;
+  LocalDb &operator=(const LocalDb &) = delete;
+  ~LocalDb();
+
+  /* Loads dir, going through the index cache at cachePath unless it is
+   * empty. Returns true if the cache was still valid. Throws
+   * std::runtime_error if dir can't be read. */
+  bool open(const std::string &dir, const std::string &cachePath);
+
+  const PackageView &packages() const { return _view; }
+
+  /* Fills table with the packages under dir (usually
+   * /var/lib/pacman/local) sorted by name, reading the desc files with the
+   * given method. Returns the method that was actually used. */
+  static BatchReader::Method load(
+      const std::string &dir, PackageTable &table,
+      BatchReader::Method method = BatchReader::Method::Auto);
+
+  /* Persists table as the index of the directory described by dirStat. */
+  static bool writeCache(const std::string &cachePath, const struct stat &dirStat,
+                         const PackageTable &table);
+
+ private:
+  bool mapCache(const std::string &cachePath, const struct stat &dirStat);
+  void unmap();
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include "Metrics.hh"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+
+void header(ostream &out, const char *name, const char *type,
+            const char *help) {
+  out << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' '
+      << type << '\n';
+}
+
+void backend(ostream &out, const char *metric, const char *name,
+             const BackendRun &run, double value) {
+  out << metric << "{backend=\"" << name << "\",source=\"" << run.source
+      << "\"} " << value << '\n';
+}
+
+}  // namespace
+
+void BackendRun::clear() {
+  source = nullptr;
+  seconds = 0;
+  exitStatus = -1;
+  bytesRead = 0;
+  updates = 0;
+  repos.clear();
+}
+
+void Metrics::recordCheck(const BackendRun &repo, const BackendRun &aur,
+                          double seconds) {
+  _repo = repo;
+  _aur = aur;
+  _checkSeconds = seconds;
+  ++_checks;
+  _lastCheck = time(nullptr);
+}
+
+void Metrics::recordNotification(bool shown) {
+  ++(shown ? _notificationsShown : _notificationsFailed);
+}
+
+void Metrics::recordAllocations(uint64_t allocations) {
+  _checkAllocations = static_cast<int64_t>(allocations);
+}
+
+uint64_t Metrics::residentBytes() {
+  ifstream statm("/proc/self/statm");
+  uint64_t size = 0, resident = 0;
+  if (!(statm >> size >> resident)) {
+    return 0;
+  }
+  return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+bool Metrics::write(const string &path) const {
+  ostringstream out;
+  const pair<const char *, const BackendRun *> backends[] = {{"repo", &_repo},
+                                                             {"aur", &_aur}};
+
+  header(out, "aarchup_backend_duration_seconds", "gauge",
+         "Wall time of the backend in the last check.");
+  for (const auto &b : backends) {
+    if (b.second->source) {
+      backend(out, "aarchup_backend_duration_seconds", b.first, *b.second,
+              b.second->seconds);
+    }
+  }
+  header(out, "aarchup_backend_exit_status", "gauge",
+         "Exit status of the backend in the last check, -1 if it couldn't run.");
+  for (const auto &b : backends) {
+    if (b.second->source) {
+      backend(out, "aarchup_backend_exit_status", b.first, *b.second,
+              b.second->exitStatus);
+    }
+  }
+  header(out, "aarchup_backend_read_bytes", "gauge",
+         "Bytes read from the backend command in the last check.");
+  for (const auto &b : backends) {
+    if (b.second->source) {
+      backend(out, "aarchup_backend_read_bytes", b.first, *b.second,
+              static_cast<double>(b.second->bytesRead));
+    }
+  }
+  header(out, "aarchup_pending_updates", "gauge",
+         "Updates found by the last check.");
+  for (const auto &b : backends) {
+    if (b.second->source) {
+      out << "aarchup_pending_updates{backend=\"" << b.first << "\"} "
+          << b.second->updates << '\n';
+    }
+  }
+  header(out, "aarchup_check_duration_seconds", "gauge",
+         "Wall time of the last check, backends included.");
+  out << "aarchup_check_duration_seconds " << _checkSeconds << '\n';
+  header(out, "aarchup_last_check_timestamp_seconds", "gauge",
+         "When the last check finished.");
+  out << "aarchup_last_check_timestamp_seconds " << _lastCheck << '\n';
+  header(out, "aarchup_checks_total", "counter", "Checks run by this process.");
+  out << "aarchup_checks_total " << _checks << '\n';
+  header(out, "aarchup_notifications_total", "counter",
+         "Notifications the server accepted or refused.");
+  out << "aarchup_notifications_total{result=\"shown\"} " << _notificationsShown
+      << "\naarchup_notifications_total{result=\"failed\"} "
+      << _notificationsFailed << '\n';
+  if (_checkAllocations >= 0) {
+    header(out, "aarchup_check_heap_allocations", "gauge",
+           "Heap allocations made by the last check (counting builds only).");
+    out << "aarchup_check_heap_allocations " << _checkAllocations << '\n';
+  }
+  header(out, "aarchup_resident_memory_bytes", "gauge",
+         "Resident set size of the aarchup process.");
+  out << "aarchup_resident_memory_bytes " << residentBytes() << '\n';
+
+  const string text = out.str();
+
+  /* Write aside and rename, so a scraper never reads half a file; the
+   * temporary name is unique, so two instances never share it. */
+  string tmpPath = path + ".XXXXXX";
+  const int fd = mkostemp(&tmpPath[0], O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  fchmod(fd, 0644);
+  FILE *file = fdopen(fd, "w");
+  if (!file) {
+    close(fd);
+    unlink(tmpPath.c_str());
+    return false;
+  }
+  const bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+  if (fclose(file) != 0 || !written ||
+      rename(tmpPath.c_str(), path.c_str()) != 0) {
+    unlink(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
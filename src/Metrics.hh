@@ -0,0 +1,57 @@
+#ifndef AARCHUP_METRICS_H
+#define AARCHUP_METRICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* How one backend run of a check went. */
+struct BackendRun {
+  /* "command" or "native"; null if the backend didn't run. */
+  const char *source = nullptr;
+  double seconds = 0;
+  /* Exit code of the command (128 + signal if it was killed), 0 for a
+   * native read that worked, -1 if nothing could be run. */
+  int exitStatus = -1;
+  uint64_t bytesRead = 0;
+  /* All pending updates, not just the lines that fit the notification. */
+  size_t updates = 0;
+  /* The same by repo, when the backend can tell them apart. */
+  std::vector<std::pair<std::string, size_t>> repos;
+
+  /* Back to a run that didn't happen, keeping repos' storage. */
+  void clear();
+};
+
+/* What the process did so far, written for node_exporter's textfile
+ * collector. Gauges describe the last check, counters the whole process. */
+class Metrics {
+  BackendRun _repo;
+  BackendRun _aur;
+  double _checkSeconds = 0;
+  uint64_t _checks = 0;
+  time_t _lastCheck = 0;
+  uint64_t _notificationsShown = 0;
+  uint64_t _notificationsFailed = 0;
+  int64_t _checkAllocations = -1;
+
+ public:
+  void recordCheck(const BackendRun &repo, const BackendRun &aur,
+                   double seconds);
+  void recordNotification(bool shown);
+  /* Heap allocations the last check made, where they are counted. */
+  void recordAllocations(uint64_t allocations);
+
+  /* Writes aside and renames over path, so the collector never reads a
+   * partial file. Returns false on failure. */
+  bool write(const std::string &path) const;
+
+  /* Resident set size of this process from /proc/self/statm, 0 if it
+   * can't be read. */
+  static uint64_t residentBytes();
+};
+
+#endif
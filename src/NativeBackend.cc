@@ -0,0 +1,76 @@
+#include "NativeBackend.hh"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "SyncDb.hh"
+#include "UpdateDiff.hh"
+#include "XdgDirs.hh"
+
+using namespace std;
+
+NativeBackend::NativeBackend(PacmanConf conf, const string &cacheDir)
+    : _conf(std::move(conf)), _localDir(_conf.localDir()) {
+  /* Worked out once, a backend kept across checks builds no paths. */
+  for (const string &repo : _conf.repos) {
+    _syncDbs.push_back(_conf.syncDb(repo));
+  }
+  if (!cacheDir.empty() && makeDirs(cacheDir)) {
+    _cachePath = cacheDir + "/localdb.idx";
+  }
+}
+
+size_t NativeBackend::check(const LineSplitter::LineHandler &onLine,
+                            RepoCounts *counts, PackageTable *foreign,
+                            pmr::memory_resource *scratch) const {
+  LocalDb localDb;
+  localDb.open(_localDir, _cachePath);
+  const PackageView &local = localDb.packages();
+  pmr::vector<PackageTable> repos(scratch);
+  pmr::vector<PackageView> views(scratch);
+  repos.reserve(_syncDbs.size());
+  views.reserve(_syncDbs.size());
+  for (const string &syncDb : _syncDbs) {
+    repos.emplace_back(scratch);
+    SyncDb::load(syncDb, repos.back());
+    views.push_back(repos.back().view());
+  }
+
+  if (foreign) {
+    pmr::vector<uint32_t> indexes(scratch);
+    UpdateDiff::foreign(local, views, indexes);
+    foreign->clear();
+    for (const uint32_t i : indexes) {
+      foreign->add(local.name(i), local.version(i));
+    }
+    /* Already in name order, as the local view is. */
+  }
+
+  pmr::vector<PendingUpdate> pending(scratch);
+  UpdateDiff::run(local, views, pending);
+  if (counts) {
+    counts->clear();
+    for (const string &repo : _conf.repos) {
+      counts->emplace_back(repo, 0);
+    }
+    for (const PendingUpdate &p : pending) {
+      ++(*counts)[p.repo].second;
+    }
+  }
+
+  bool wanted = true;
+  pmr::string line(scratch);
+  for (const PendingUpdate &p : pending) {
+    if (!wanted) {
+      break;
+    }
+    line.assign(local.name(p.local));
+    line += ' ';
+    line += local.version(p.local);
+    line += " -> ";
+    line += views[p.repo].version(p.sync);
+    wanted = onLine(line);
+  }
+  return pending.size();
+}
@@ -0,0 +1,44 @@
+#ifndef AARCHUP_NATIVEBACKEND_H
+#define AARCHUP_NATIVEBACKEND_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "LineSplitter.hh"
+#include "LocalDb.hh"
+#include "PackageTable.hh"
+#include "PacmanConf.hh"
+
+/* Works out pending repo updates from pacman's databases in-process,
+ * producing the same "<name> <old> -> <new>" lines as checkupdates. The sync
+ * databases are read as they are on disk and are not refreshed. */
+class NativeBackend {
+  PacmanConf _conf;
+  std::string _localDir;
+  std::vector<std::string> _syncDbs;
+  std::string _cachePath;
+
+ public:
+  /* cacheDir holds the local index cache and is created here; empty
+   * disables it. */
+  NativeBackend(PacmanConf conf, const std::string &cacheDir);
+
+  /* Pending updates of each repo, in pacman.conf order. */
+  typedef std::vector<std::pair<std::string, size_t>> RepoCounts;
+
+  /* Hands each pending update to onLine until it returns false and returns
+   * how many there were, also per repo into counts when given. When foreign
+   * is given, the installed packages no sync repository carries are copied
+   * into it too, sorted by name, from the same read of the databases. The
+   * sync databases are read into scratch, which only needs to outlive the
+   * call. Throws std::runtime_error if a database can't be read. */
+  size_t check(const LineSplitter::LineHandler &onLine,
+               RepoCounts *counts = nullptr, PackageTable *foreign = nullptr,
+               std::pmr::memory_resource *scratch =
+                   std::pmr::get_default_resource()) const;
+};
+
+#endif
@@ -0,0 +1,231 @@
+#include "Notifier.hh"
+
+#include <gio/gio.h>
+
+using namespace std;
+
+const char *const Notifier::BUS_NAME = "org.freedesktop.Notifications";
+const char *const Notifier::OBJECT_PATH = "/org/freedesktop/Notifications";
+const char *const Notifier::INTERFACE = "org.freedesktop.Notifications";
+
+/* A call waiting for its reply. Notify replies go to onShown, the others
+ * to onReply. */
+struct Notifier::Call {
+  ShownHandler onShown;
+  ReplyHandler onReply;
+  Notifier *notifier;
+  Call *next;
+};
+
+Notifier::Notifier(const string &appName)
+    : _appName(appName),
+      _connection(nullptr),
+      _cancellable(g_cancellable_new()),
+      _watch(0),
+      _closedSignal(0),
+      _pending(0),
+      _freeCalls(nullptr) {}
+
+Notifier::~Notifier() {
+  g_cancellable_cancel(_cancellable);
+  flush();
+  disconnect();
+  g_object_unref(_cancellable);
+  while (_freeCalls) {
+    Call *next = _freeCalls->next;
+    delete _freeCalls;
+    _freeCalls = next;
+  }
+}
+
+void Notifier::setClosedHandler(function<void(uint32_t id)> onClosed) {
+  _onClosed = move(onClosed);
+}
+
+void Notifier::setRestartHandler(function<void()> onRestart) {
+  _onRestart = move(onRestart);
+}
+
+bool Notifier::connect(string &error) {
+  if (_connection && !g_dbus_connection_is_closed(_connection)) {
+    return true;
+  }
+  disconnect();
+  /* A private connection rather than the shared one, which would exit
+   * the process when the session bus goes away. */
+  GError *gerror = nullptr;
+  gchar *address =
+      g_dbus_address_get_for_bus_sync(G_BUS_TYPE_SESSION, nullptr, &gerror);
+  if (address) {
+    _connection = g_dbus_connection_new_for_address_sync(
+        address,
+        static_cast<GDBusConnectionFlags>(
+            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+            G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION),
+        nullptr, nullptr, &gerror);
+    g_free(address);
+  }
+  if (!_connection) {
+    error = gerror->message;
+    g_error_free(gerror);
+    return false;
+  }
+  if (!_owner.empty()) {
+    /* A new bus means a new daemon, whatever its name. */
+    _owner.clear();
+    if (_onRestart) {
+      _onRestart();
+    }
+  }
+  _watch = g_bus_watch_name_on_connection(
+      _connection, BUS_NAME, G_BUS_NAME_WATCHER_FLAGS_NONE, onNameAppeared,
+      onNameVanished, this, nullptr);
+  _closedSignal = g_dbus_connection_signal_subscribe(
+      _connection, BUS_NAME, INTERFACE, "NotificationClosed", OBJECT_PATH,
+      nullptr, G_DBUS_SIGNAL_FLAGS_NONE, onSignal, this, nullptr);
+  return true;
+}
+
+void Notifier::disconnect() {
+  if (!_connection) {
+    return;
+  }
+  g_bus_unwatch_name(_watch);
+  g_dbus_connection_signal_unsubscribe(_connection, _closedSignal);
+  g_object_unref(_connection);
+  _connection = nullptr;
+  _watch = 0;
+  _closedSignal = 0;
+}
+
+Notifier::Call *Notifier::newCall() {
+  Call *call = _freeCalls;
+  if (call) {
+    _freeCalls = call->next;
+  } else {
+    call = new Call();
+  }
+  call->notifier = this;
+  call->next = nullptr;
+  return call;
+}
+
+void Notifier::send(const char *method, GVariant *parameters,
+                    const char *replyType, Call *call) {
+  string error;
+  if (!connect(error)) {
+    /* parameters is floating, sink it so it doesn't leak. */
+    g_variant_unref(g_variant_ref_sink(parameters));
+    finish(call, nullptr, error);
+    return;
+  }
+  ++_pending;
+  g_dbus_connection_call(
+      _connection, BUS_NAME, OBJECT_PATH, INTERFACE, method, parameters,
+      replyType ? G_VARIANT_TYPE(replyType) : nullptr, G_DBUS_CALL_FLAGS_NONE,
+      -1, _cancellable, onCallDone, call);
+}
+
+void Notifier::show(uint32_t replacesId, const char *summary, const char *body,
+                    const char *icon, const char *category, Urgency urgency,
+                    int timeoutMs, const ShownHandler &onShown) {
+  GVariantBuilder hints;
+  g_variant_builder_init(&hints, G_VARIANT_TYPE("a{sv}"));
+  g_variant_builder_add(&hints, "{sv}", "urgency",
+                        g_variant_new_byte(static_cast<guint8>(urgency)));
+  if (category) {
+    g_variant_builder_add(&hints, "{sv}", "category",
+                          g_variant_new_string(category));
+  }
+  /* (app_name, replaces_id, app_icon, summary, body, actions, hints,
+   * expire_timeout); a NULL builder is an empty actions array. */
+  GVariant *parameters = g_variant_new(
+      "(susssasa{sv}i)", _appName.c_str(), replacesId, icon ? icon : "",
+      summary, body, nullptr, &hints, timeoutMs);
+  Call *call = newCall();
+  call->onShown = onShown;
+  send("Notify", parameters, "(u)", call);
+}
+
+void Notifier::close(uint32_t id, const ReplyHandler &onReply) {
+  Call *call = newCall();
+  call->onReply = onReply;
+  send("CloseNotification", g_variant_new("(u)", id), nullptr, call);
+}
+
+void Notifier::onCallDone(GObject *source, GAsyncResult *result,
+                          void *data) {
+  Call *call = static_cast<Call *>(data);
+  Notifier &self = *call->notifier;
+  GError *error = nullptr;
+  GVariant *reply = g_dbus_connection_call_finish(
+      reinterpret_cast<GDBusConnection *>(source), result, &error);
+  --self._pending;
+  /* A cancelled call belongs to a Notifier that is going away. */
+  if (g_cancellable_is_cancelled(self._cancellable)) {
+    call->onShown = nullptr;
+    call->onReply = nullptr;
+    call->next = self._freeCalls;
+    self._freeCalls = call;
+  } else {
+    self.finish(call, reply, error ? error->message : string());
+  }
+  if (reply) {
+    g_variant_unref(reply);
+  }
+  if (error) {
+    g_error_free(error);
+  }
+}
+
+void Notifier::finish(Call *call, GVariant *reply, const string &error) {
+  /* Back on the free list first, a handler may well start another call. */
+  const ShownHandler onShown = std::move(call->onShown);
+  const ReplyHandler onReply = std::move(call->onReply);
+  call->onShown = nullptr;
+  call->onReply = nullptr;
+  call->next = _freeCalls;
+  _freeCalls = call;
+  if (onShown) {
+    guint32 id = 0;
+    if (reply) {
+      g_variant_get(reply, "(u)", &id);
+    }
+    onShown(id, error);
+  } else if (onReply) {
+    onReply(error);
+  }
+}
+
+void Notifier::flush() {
+  while (_pending > 0) {
+    g_main_context_iteration(nullptr, TRUE);
+  }
+}
+
+void Notifier::onNameAppeared(GDBusConnection *, const char *,
+                              const char *owner, void *data) {
+  Notifier &self = *static_cast<Notifier *>(data);
+  if (!self._owner.empty() && self._owner != owner && self._onRestart) {
+    self._onRestart();
+  }
+  self._owner = owner;
+}
+
+void Notifier::onNameVanished(GDBusConnection *, const char *, void *) {
+  /* Nothing to do until a daemon shows up again; many are only started
+   * by the next call. _owner stays to tell a restart from the first
+   * appearance. */
+}
+
+void Notifier::onSignal(GDBusConnection *, const char *, const char *,
+                        const char *, const char *,
+                        GVariant *parameters, void *data) {
+  Notifier &self = *static_cast<Notifier *>(data);
+  guint32 id = 0;
+  guint32 reason = 0;
+  g_variant_get(parameters, "(uu)", &id, &reason);
+  if (self._onClosed) {
+    self._onClosed(id);
+  }
+}
@@ -0,0 +1,97 @@
+#ifndef AARCHUP_NOTIFIER_H
+#define AARCHUP_NOTIFIER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+typedef struct _GAsyncResult GAsyncResult;
+typedef struct _GCancellable GCancellable;
+typedef struct _GDBusConnection GDBusConnection;
+typedef struct _GObject GObject;
+typedef struct _GVariant GVariant;
+
+/* Talks to org.freedesktop.Notifications over one long-lived session bus
+ * connection. Calls are asynchronous and finish on the default main
+ * context; the daemon's owner is watched, so a restarted notification
+ * daemon is noticed without reconnecting to the bus. */
+class Notifier {
+  std::string _appName;
+  GDBusConnection *_connection;
+  GCancellable *_cancellable;
+  unsigned _watch;
+  unsigned _closedSignal;
+  std::string _owner;
+  unsigned _pending;
+  std::function<void(uint32_t id)> _onClosed;
+  std::function<void()> _onRestart;
+  struct Call;
+  /* Finished calls, kept so the next ones don't allocate. */
+  Call *_freeCalls;
+
+ public:
+  static const char *const BUS_NAME;
+  static const char *const OBJECT_PATH;
+  static const char *const INTERFACE;
+
+  /* The spec's urgency hint values. */
+  enum class Urgency : uint8_t { Low = 0, Normal = 1, Critical = 2 };
+
+  /* id is the server's id for the notification, 0 if it couldn't be shown
+   * and error says why. */
+  typedef std::function<void(uint32_t id, const std::string &error)>
+      ShownHandler;
+  /* error is empty if the call succeeded. */
+  typedef std::function<void(const std::string &error)> ReplyHandler;
+
+  explicit Notifier(const std::string &appName);
+  Notifier(const Notifier &) = delete;
+  Notifier &operator=(const Notifier &) = delete;
+  ~Notifier();
+
+  /* Called with the id of every notification the server closed, whether
+   * it expired, was dismissed or was closed through close(). */
+  void setClosedHandler(std::function<void(uint32_t id)> onClosed);
+
+  /* Called when the notification daemon was replaced by another one, so
+   * ids handed out by the old one mean nothing anymore. */
+  void setRestartHandler(std::function<void()> onRestart);
+
+  /* Shows a notification, replacing replacesId if the server still has
+   * it. timeoutMs follows the spec: -1 lets the server decide, 0 never
+   * expires. */
+  void show(uint32_t replacesId, const char *summary, const char *body,
+            const char *icon, const char *category, Urgency urgency,
+            int timeoutMs, const ShownHandler &onShown);
+
+  /* Asks the server to close notification id. */
+  void close(uint32_t id, const ReplyHandler &onReply);
+
+  /* Runs the default main context until every call got its reply, for
+   * callers without a main loop of their own. */
+  void flush();
+
+ private:
+  /* Connects to the session bus unless the connection is still open.
+   * Returns false with error set if the bus can't be reached. */
+  bool connect(std::string &error);
+  void disconnect();
+  Call *newCall();
+  /* Sends method and hands the reply to call's handler. */
+  void send(const char *method, GVariant *parameters, const char *replyType,
+            Call *call);
+
+  /* Recycles call, then runs its handler with the reply, if any. */
+  void finish(Call *call, GVariant *reply, const std::string &error);
+
+  static void onCallDone(GObject *source, GAsyncResult *result, void *data);
+
+  static void onNameAppeared(GDBusConnection *, const char *,
+                             const char *owner, void *data);
+  static void onNameVanished(GDBusConnection *, const char *, void *data);
+  static void onSignal(GDBusConnection *, const char *, const char *,
+                       const char *, const char *,
+                       GVariant *parameters, void *data);
+};
+
+#endif
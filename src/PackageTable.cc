@@ -0,0 +1,83 @@
+#include "PackageTable.hh"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+void PackageTable::reserve(size_t packages, size_t poolBytes) {
+  _entries.reserve(packages);
+  _pool.reserve(poolBytes);
+}
+
+void PackageTable::add(string_view name, string_view version) {
+  if (name.size() > UINT16_MAX || version.size() > UINT16_MAX ||
+      _pool.size() + name.size() + version.size() > UINT32_MAX) {
+    throw std::runtime_error("Package table overflow");
+  }
+  PackageEntry e;
+  e.name = static_cast<uint32_t>(_pool.size());
+  e.nameLen = static_cast<uint16_t>(name.size());
+  _pool.append(name.data(), name.size());
+  e.version = static_cast<uint32_t>(_pool.size());
+  e.versionLen = static_cast<uint16_t>(version.size());
+  _pool.append(version.data(), version.size());
+  _entries.push_back(e);
+}
+
+void PackageTable::clear() {
+  _pool.clear();
+  _entries.clear();
+}
+
+void PackageTable::sortByName() {
+  const char *pool = _pool.data();
+  std::sort(_entries.begin(), _entries.end(),
+            [pool](const PackageEntry &a, const PackageEntry &b) {
+              return string_view(pool + a.name, a.nameLen) <
+                     string_view(pool + b.name, b.nameLen);
+            });
+}
+
+size_t PackageView::find(string_view name) const {
+  const char *pool = _pool;
+  const PackageEntry *end = _entries + _count;
+  const PackageEntry *it = std::lower_bound(
+      _entries, end, name, [pool](const PackageEntry &e, string_view key) {
+        return string_view(pool + e.name, e.nameLen) < key;
+      });
+  if (it != end && string_view(pool + it->name, it->nameLen) == name) {
+    return static_cast<size_t>(it - _entries);
+  }
+  return _count;
+}
+
+/* Returns the line starting at pos and moves pos past it. */
+static string_view nextLine(string_view text, size_t &pos) {
+  const size_t start = pos;
+  size_t end = text.find('\n', start);
+  if (end == string_view::npos) {
+    end = text.size();
+    pos = end;
+  } else {
+    pos = end + 1;
+  }
+  return text.substr(start, end - start);
+}
+
+bool parseDesc(string_view desc, string_view &name, string_view &version) {
+  bool haveName = false;
+  bool haveVersion = false;
+  size_t pos = 0;
+  while (pos < desc.size() && !(haveName && haveVersion)) {
+    const string_view line = nextLine(desc, pos);
+    if (line == "%NAME%") {
+      name = nextLine(desc, pos);
+      haveName = true;
+    } else if (line == "%VERSION%") {
+      version = nextLine(desc, pos);
+      haveVersion = true;
+    }
+  }
+  return haveName && haveVersion && !name.empty() && !version.empty();
+}
@@ -0,0 +1,90 @@
+#ifndef AARCHUP_PACKAGETABLE_H
+#define AARCHUP_PACKAGETABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Offsets of one package's name and version inside a string pool. The
+ * layout is also the on-disk format of the local index cache. */
+struct PackageEntry {
+  uint32_t name;
+  uint32_t version;
+  uint16_t nameLen;
+  uint16_t versionLen;
+};
+
+/* Read-only view of entries sorted by name over a string pool, which may
+ * live in a PackageTable or in a mapped cache file. */
+class PackageView {
+  const PackageEntry *_entries = nullptr;
+  size_t _count = 0;
+  const char *_pool = nullptr;
+
+ public:
+  PackageView() = default;
+  PackageView(const PackageEntry *entries, size_t count, const char *pool)
+      : _entries(entries), _count(count), _pool(pool) {}
+
+  /* Returns the index of name, or size() if it is not in the view. */
+  size_t find(std::string_view name) const;
+
+  size_t size() const { return _count; }
+  bool empty() const { return _count == 0; }
+
+  std::string_view name(size_t i) const {
+    const PackageEntry &e = _entries[i];
+    return std::string_view(_pool + e.name, e.nameLen);
+  }
+
+  std::string_view version(size_t i) const {
+    const PackageEntry &e = _entries[i];
+    return std::string_view(_pool + e.version, e.versionLen);
+  }
+};
+
+/* Package name/version pairs packed into a single string pool, so a repo of
+ * ten thousand packages costs two allocations instead of twenty thousand.
+ * Both come from the given memory resource, the heap by default. */
+class PackageTable {
+  std::pmr::string _pool;
+  std::pmr::vector<PackageEntry> _entries;
+
+ public:
+  PackageTable() = default;
+  explicit PackageTable(std::pmr::memory_resource *resource)
+      : _pool(resource), _entries(resource) {}
+
+  void reserve(size_t packages, size_t poolBytes);
+  void add(std::string_view name, std::string_view version);
+  void clear();
+
+  /* Orders the entries by name; find() relies on it. */
+  void sortByName();
+
+  PackageView view() const {
+    return PackageView(_entries.data(), _entries.size(), _pool.data());
+  }
+
+  size_t find(std::string_view name) const { return view().find(name); }
+  size_t size() const { return _entries.size(); }
+  bool empty() const { return _entries.empty(); }
+  std::string_view name(size_t i) const { return view().name(i); }
+  std::string_view version(size_t i) const { return view().version(i); }
+
+  const std::pmr::vector<PackageEntry> &entries() const { return _entries; }
+  const std::pmr::string &pool() const { return _pool; }
+  std::pmr::memory_resource *resource() const {
+    return _entries.get_allocator().resource();
+  }
+};
+
+/* Pulls %NAME% and %VERSION% out of a pacman desc file. Returns false if
+ * either is missing. */
+bool parseDesc(std::string_view desc, std::string_view &name,
+               std::string_view &version);
+
+#endif
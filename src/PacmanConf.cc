@@ -0,0 +1,85 @@
+#include "PacmanConf.hh"
+
+#include <glob.h>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+const char *const PacmanConf::DEFAULT_PATH = "/etc/pacman.conf";
+const int PacmanConf::MAX_INCLUDE_DEPTH;
+
+static string trim(const string &s) {
+  const auto first = s.find_first_not_of(" \t\r");
+  if (first == string::npos) {
+    return string();
+  }
+  const auto last = s.find_last_not_of(" \t\r");
+  return s.substr(first, last - first + 1);
+}
+
+/* Reads one file into conf. Include pulls in every file its glob matches,
+ * right where it stands, as pacman does; section is shared so a file may
+ * open sections for the ones after it. */
+static void parseFile(const char *path, PacmanConf &conf, string &section,
+                      int depth) {
+  if (depth > PacmanConf::MAX_INCLUDE_DEPTH) {
+    std::stringstream ss;
+    ss << "Includes nested too deeply at " << path;
+    throw std::runtime_error(ss.str());
+  }
+  ifstream in(path);
+  if (!in) {
+    std::stringstream ss;
+    ss << "Failed to open " << path;
+    throw std::runtime_error(ss.str());
+  }
+  string line;
+  while (getline(in, line)) {
+    const auto hash = line.find('#');
+    if (hash != string::npos) {
+      line.erase(hash);
+    }
+    line = trim(line);
+    if (line.empty()) {
+      continue;
+    }
+    if (line.front() == '[' && line.back() == ']') {
+      section = line.substr(1, line.size() - 2);
+      if (section != "options") {
+        conf.repos.push_back(section);
+      }
+      continue;
+    }
+    const auto eq = line.find('=');
+    if (eq == string::npos) {
+      continue;
+    }
+    const string key = trim(line.substr(0, eq));
+    const string value = trim(line.substr(eq + 1));
+    if (key == "Include") {
+      glob_t matches;
+      if (glob(value.c_str(), 0, nullptr, &matches) == 0) {
+        unique_ptr<glob_t, void (*)(glob_t *)> guard(&matches, globfree);
+        for (size_t i = 0; i < matches.gl_pathc; ++i) {
+          parseFile(matches.gl_pathv[i], conf, section, depth + 1);
+        }
+      }
+      /* Like pacman, an Include that matches nothing is not an error. */
+    } else if (section == "options" && key == "DBPath") {
+      conf.dbPath = value;
+      if (!conf.dbPath.empty() && conf.dbPath.back() != '/') {
+        conf.dbPath += '/';
+      }
+    }
+  }
+}
+
+PacmanConf PacmanConf::load(const char *path) {
+  PacmanConf conf;
+  string section;
+  parseFile(path, conf, section, 0);
+  return conf;
+}
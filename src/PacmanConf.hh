@@ -0,0 +1,28 @@
+#ifndef AARCHUP_PACMANCONF_H
+#define AARCHUP_PACMANCONF_H
+
+#include <string>
+#include <vector>
+
+/* The parts of pacman.conf aarchup needs to read the package databases.
+ * Include directives are followed, so repos and options set in included
+ * files count too. */
+struct PacmanConf {
+  static const char *const DEFAULT_PATH;
+  /* Include chains deeper than this are taken for a loop. */
+  static const int MAX_INCLUDE_DEPTH = 10;
+
+  std::string dbPath = "/var/lib/pacman/";
+  /* Sync repositories in the order pacman searches them. */
+  std::vector<std::string> repos;
+
+  std::string localDir() const { return dbPath + "local"; }
+  std::string syncDir() const { return dbPath + "sync"; }
+  std::string syncDb(const std::string &repo) const {
+    return syncDir() + "/" + repo + ".db";
+  }
+
+  static PacmanConf load(const char *path);
+};
+
+#endif
@@ -0,0 +1,60 @@
+#include "PacmanWatcher.hh"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+const chrono::milliseconds PacmanWatcher::DEFAULT_QUIET(2000);
+const chrono::milliseconds PacmanWatcher::STALE_LOCK(10 * 60 * 1000);
+
+PacmanWatcher::PacmanWatcher(const PacmanConf &conf)
+    : _fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+      _lockPath(conf.dbPath + "db.lck") {
+  if (_fd < 0) {
+    std::stringstream ss;
+    ss << "Failed to initialise inotify: " << strerror(errno);
+    throw std::runtime_error(ss.str());
+  }
+  const struct {
+    string path;
+    uint32_t mask;
+  } watches[] = {
+      {conf.dbPath, IN_CREATE | IN_DELETE},
+      {conf.localDir(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO},
+      {conf.syncDir(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE},
+  };
+  for (const auto &watch : watches) {
+    if (inotify_add_watch(_fd, watch.path.c_str(), watch.mask | IN_ONLYDIR) < 0) {
+      const int err = errno;
+      close(_fd);
+      std::stringstream ss;
+      ss << "Failed to watch " << watch.path << ": " << strerror(err);
+      throw std::runtime_error(ss.str());
+    }
+  }
+}
+
+PacmanWatcher::~PacmanWatcher() { close(_fd); }
+
+bool PacmanWatcher::drain() {
+  alignas(inotify_event) char buffer[4096];
+  bool any = false;
+  while (true) {
+    const ssize_t n = read(_fd, buffer, sizeof(buffer));
+    if (n > 0) {
+      any = true;
+      continue;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    return any;
+  }
+}
+
+bool PacmanWatcher::locked() const { return access(_lockPath.c_str(), F_OK) == 0; }
@@ -0,0 +1,40 @@
+#ifndef AARCHUP_PACMANWATCHER_H
+#define AARCHUP_PACMANWATCHER_H
+
+#include <chrono>
+#include <string>
+
+#include "PacmanConf.hh"
+
+/* Watches pacman's database directory with inotify: the local database
+ * (packages installed or removed), the sync databases (a -Sy) and the
+ * db.lck lock that brackets every transaction. */
+class PacmanWatcher {
+  int _fd;
+  std::string _lockPath;
+
+ public:
+  /* How long the databases have to stay untouched before a burst of
+   * events counts as finished. */
+  static const std::chrono::milliseconds DEFAULT_QUIET;
+  /* How long db.lck may outlast a burst before it is taken for one left
+   * behind by a pacman that died. */
+  static const std::chrono::milliseconds STALE_LOCK;
+
+  /* Throws std::runtime_error if the directories can't be watched. */
+  explicit PacmanWatcher(const PacmanConf &conf);
+  PacmanWatcher(const PacmanWatcher &) = delete;
+  PacmanWatcher &operator=(const PacmanWatcher &) = delete;
+  ~PacmanWatcher();
+
+  int fd() const { return _fd; }
+
+  /* Reads all queued events without blocking. Returns true if there were
+   * any. */
+  bool drain();
+
+  /* True while pacman holds db.lck, i.e. a transaction is running. */
+  bool locked() const;
+};
+
+#endif
@@ -0,0 +1,362 @@
+#include "SyncDb.hh"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#ifdef AARCHUP_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace std;
+
+const size_t SyncDb::READ_CHUNK;
+const size_t SyncDb::MAX_DESC_SIZE;
+
+namespace {
+
+const size_t BLOCK = 512;
+
+[[noreturn]] void fail(const string &path, const char *what) {
+  std::stringstream ss;
+  ss << "Failed to read sync database " << path << ": " << what;
+  throw std::runtime_error(ss.str());
+}
+
+/* Walks a ustar stream fed in arbitrary pieces and adds every desc member
+ * to the table. GNU long names and pax path records are honoured, since
+ * bsdtar emits them for long package names. */
+class TarReader {
+  enum class Member { Skip, Desc, LongName, Pax };
+
+  PackageTable &_table;
+  char _header[BLOCK];
+  size_t _headerFill = 0;
+  uint64_t _remaining = 0;
+  uint64_t _padding = 0;
+  Member _member = Member::Skip;
+  pmr::string _data;
+  pmr::string _name;
+  pmr::string _nextName;
+
+ public:
+  /* Scratch strings share the table's memory resource. */
+  explicit TarReader(PackageTable &table)
+      : _table(table),
+        _data(table.resource()),
+        _name(table.resource()),
+        _nextName(table.resource()) {}
+
+  void feed(const char *data, size_t size) {
+    while (size > 0) {
+      if (_remaining > 0) {
+        const size_t take = static_cast<size_t>(min<uint64_t>(size, _remaining));
+        if (_member != Member::Skip) {
+          _data.append(data, take);
+        }
+        _remaining -= take;
+        data += take;
+        size -= take;
+        if (_remaining == 0) {
+          finishMember();
+        }
+      } else if (_padding > 0) {
+        const size_t take = static_cast<size_t>(min<uint64_t>(size, _padding));
+        _padding -= take;
+        data += take;
+        size -= take;
+      } else {
+        const size_t take = min(size, BLOCK - _headerFill);
+        memcpy(_header + _headerFill, data, take);
+        _headerFill += take;
+        data += take;
+        size -= take;
+        if (_headerFill == BLOCK) {
+          _headerFill = 0;
+          parseHeader();
+        }
+      }
+    }
+  }
+
+  bool complete() const { return _remaining == 0 && _headerFill == 0; }
+  pmr::memory_resource *resource() const { return _table.resource(); }
+
+ private:
+  static uint64_t parseOctal(const char *field, size_t len) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < len && field[i]; ++i) {
+      if (field[i] >= '0' && field[i] <= '7') {
+        value = value * 8 + static_cast<uint64_t>(field[i] - '0');
+      } else if (field[i] != ' ') {
+        break;
+      }
+    }
+    return value;
+  }
+
+  static string_view field(const char *data, size_t len) {
+    return string_view(data, strnlen(data, len));
+  }
+
+  void parseHeader() {
+    if (all_of(_header, _header + BLOCK, [](char c) { return c == 0; })) {
+      return; /* end-of-archive marker */
+    }
+    const uint64_t size = parseOctal(_header + 124, 12);
+    const char type = _header[156];
+
+    string_view name;
+    if (!_nextName.empty()) {
+      _name.swap(_nextName);
+      _nextName.clear();
+      name = _name;
+    } else {
+      const string_view prefix = field(_header + 345, 155);
+      if (prefix.empty()) {
+        name = field(_header, 100);
+      } else {
+        _name.assign(prefix);
+        _name += '/';
+        _name += field(_header, 100);
+        name = _name;
+      }
+    }
+
+    _member = Member::Skip;
+    if (type == 'L') {
+      _member = Member::LongName;
+    } else if (type == 'x') {
+      _member = Member::Pax;
+    } else if ((type == '0' || type == '\0') && size <= SyncDb::MAX_DESC_SIZE &&
+               name.size() >= 5 &&
+               name.substr(name.size() - 5) == "/desc") {
+      _member = Member::Desc;
+    }
+    _data.clear();
+    _remaining = size;
+    _padding = (BLOCK - size % BLOCK) % BLOCK;
+    if (size == 0) {
+      finishMember();
+    }
+  }
+
+  void finishMember() {
+    switch (_member) {
+      case Member::Desc: {
+        string_view name, version;
+        if (parseDesc(_data, name, version)) {
+          _table.add(name, version);
+        }
+        break;
+      }
+      case Member::LongName:
+        _nextName.assign(field(_data.data(), _data.size()));
+        break;
+      case Member::Pax:
+        parsePax();
+        break;
+      case Member::Skip:
+        break;
+    }
+    _member = Member::Skip;
+  }
+
+  /* Records are "<len> <key>=<value>\n"; only path matters here. */
+  void parsePax() {
+    size_t pos = 0;
+    while (pos < _data.size()) {
+      const size_t space = _data.find(' ', pos);
+      if (space == string::npos) {
+        return;
+      }
+      const size_t len = strtoul(_data.c_str() + pos, nullptr, 10);
+      if (len == 0 || pos + len > _data.size()) {
+        return;
+      }
+      const string_view record(_data.data() + space + 1, pos + len - space - 2);
+      if (record.compare(0, 5, "path=") == 0) {
+        _nextName.assign(record.data() + 5, record.size() - 5);
+      }
+      pos += len;
+    }
+  }
+};
+
+class ScopedFd {
+  int _fd;
+
+ public:
+  explicit ScopedFd(int fd) : _fd(fd) {}
+  ScopedFd(const ScopedFd &) = delete;
+  ScopedFd &operator=(const ScopedFd &) = delete;
+  ~ScopedFd() {
+    if (_fd >= 0) {
+      close(_fd);
+    }
+  }
+  int get() const { return _fd; }
+};
+
+/* A buffer from a memory resource, handed back when it goes out of
+ * scope. */
+class Buffer {
+  pmr::memory_resource *_resource;
+  size_t _size;
+  char *_data;
+
+ public:
+  Buffer(pmr::memory_resource *resource, size_t size)
+      : _resource(resource),
+        _size(size),
+        _data(static_cast<char *>(resource->allocate(size))) {}
+  Buffer(const Buffer &) = delete;
+  Buffer &operator=(const Buffer &) = delete;
+  ~Buffer() { _resource->deallocate(_data, _size); }
+  char *get() const { return _data; }
+};
+
+/* Reads up to size bytes, retrying on EINTR. */
+size_t readSome(int fd, char *buffer, size_t size, const string &path) {
+  ssize_t n;
+  do {
+    n = read(fd, buffer, size);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    fail(path, strerror(errno));
+  }
+  return static_cast<size_t>(n);
+}
+
+void inflateGzip(int fd, const string &path, char *in, size_t inLen,
+                 TarReader &tar) {
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  /* 32 lets zlib detect the gzip header itself. */
+  if (inflateInit2(&zs, 32 + MAX_WBITS) != Z_OK) {
+    fail(path, "inflateInit2 failed");
+  }
+  unique_ptr<z_stream, int (*)(z_stream *)> guard(&zs, inflateEnd);
+  Buffer out(tar.resource(), SyncDb::READ_CHUNK);
+  bool ended = false;
+  do {
+    zs.next_in = reinterpret_cast<Bytef *>(in);
+    zs.avail_in = static_cast<uInt>(inLen);
+    /* A full output buffer may leave output behind even with the input
+     * used up, so go on until inflate has room to spare. */
+    do {
+      zs.next_out = reinterpret_cast<Bytef *>(out.get());
+      zs.avail_out = static_cast<uInt>(SyncDb::READ_CHUNK);
+      const int ret = inflate(&zs, Z_NO_FLUSH);
+      if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+        fail(path, zs.msg ? zs.msg : "corrupt gzip stream");
+      }
+      tar.feed(out.get(), SyncDb::READ_CHUNK - zs.avail_out);
+      if (ret == Z_STREAM_END) {
+        /* Concatenated gzip members are valid, keep going. */
+        inflateReset(&zs);
+        ended = true;
+      } else if (ret == Z_BUF_ERROR) {
+        break; /* needs more input */
+      } else {
+        ended = false;
+      }
+    } while (zs.avail_in > 0 || zs.avail_out == 0);
+    inLen = readSome(fd, in, SyncDb::READ_CHUNK, path);
+  } while (inLen > 0);
+  if (!ended) {
+    fail(path, "gzip stream cut short");
+  }
+}
+
+#ifdef AARCHUP_HAVE_ZSTD
+void inflateZstd(int fd, const string &path, char *in, size_t inLen,
+                 TarReader &tar) {
+  unique_ptr<ZSTD_DStream, size_t (*)(ZSTD_DStream *)> stream(
+      ZSTD_createDStream(), ZSTD_freeDStream);
+  if (!stream) {
+    fail(path, "ZSTD_createDStream failed");
+  }
+  ZSTD_initDStream(stream.get());
+  const size_t outSize = ZSTD_DStreamOutSize();
+  Buffer out(tar.resource(), outSize);
+  /* 0 once a frame is complete and flushed. */
+  size_t ret;
+  do {
+    ZSTD_inBuffer input = {in, inLen, 0};
+    ZSTD_outBuffer output;
+    /* Like inflateGzip, drain a full output buffer even without input,
+     * unless the frame is done. */
+    do {
+      output = {out.get(), outSize, 0};
+      ret = ZSTD_decompressStream(stream.get(), &output, &input);
+      if (ZSTD_isError(ret)) {
+        fail(path, ZSTD_getErrorName(ret));
+      }
+      tar.feed(out.get(), output.pos);
+    } while (input.pos < input.size ||
+             (output.pos == output.size && ret != 0));
+    inLen = readSome(fd, in, SyncDb::READ_CHUNK, path);
+  } while (inLen > 0);
+  if (ret != 0) {
+    fail(path, "zstd stream cut short");
+  }
+}
+#endif
+
+}  // namespace
+
+void SyncDb::load(const string &path, PackageTable &table) {
+  const ScopedFd fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+  if (fd.get() < 0) {
+    fail(path, strerror(errno));
+  }
+  posix_fadvise(fd.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  Buffer in(table.resource(), READ_CHUNK);
+  size_t inLen = 0;
+  /* Fill at least one tar block so the format can be told apart. */
+  while (inLen < BLOCK) {
+    const size_t n =
+        readSome(fd.get(), in.get() + inLen, READ_CHUNK - inLen, path);
+    if (n == 0) {
+      break;
+    }
+    inLen += n;
+  }
+  if (inLen == 0) {
+    return; /* an empty repo */
+  }
+
+  TarReader tar(table);
+  const auto *magic = reinterpret_cast<const unsigned char *>(in.get());
+  if (inLen >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+    inflateGzip(fd.get(), path, in.get(), inLen, tar);
+  } else if (inLen >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 &&
+             magic[2] == 0x2f && magic[3] == 0xfd) {
+#ifdef AARCHUP_HAVE_ZSTD
+    inflateZstd(fd.get(), path, in.get(), inLen, tar);
+#else
+    fail(path, "zstd support was not compiled in");
+#endif
+  } else if (inLen >= BLOCK && memcmp(in.get() + 257, "ustar", 5) == 0) {
+    do {
+      tar.feed(in.get(), inLen);
+      inLen = readSome(fd.get(), in.get(), READ_CHUNK, path);
+    } while (inLen > 0);
+  } else {
+    fail(path, "unknown compression");
+  }
+  if (!tar.complete()) {
+    fail(path, "truncated archive");
+  }
+  table.sortByName();
+}
@@ -0,0 +1,23 @@
+#ifndef AARCHUP_SYNCDB_H
+#define AARCHUP_SYNCDB_H
+
+#include <cstddef>
+#include <string>
+
+#include "PackageTable.hh"
+
+/* Reads a pacman sync database (a gzip or zstd compressed tar of
+ * <pkg>-<ver>/desc files) straight from disk. The archive is decompressed
+ * and walked as a stream; only each package's name and version are kept. */
+class SyncDb {
+ public:
+  static const size_t READ_CHUNK = 128 * 1024;
+  /* desc files above this size are skipped rather than buffered. */
+  static const size_t MAX_DESC_SIZE = 1024 * 1024;
+
+  /* Appends the packages of the database at path to table and sorts it by
+   * name. Throws std::runtime_error on unreadable or corrupt databases. */
+  static void load(const std::string &path, PackageTable &table);
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "UpdateDiff.hh"
+
+#include "Vercmp.hh"
+
+using namespace std;
+
+void UpdateDiff::run(const PackageView &local,
+                     const pmr::vector<PackageView> &repos,
+                     pmr::vector<PendingUpdate> &updates) {
+  pmr::memory_resource *scratch = updates.get_allocator().resource();
+  const size_t first = updates.size();
+  pmr::vector<size_t> cursor(repos.size(), 0, scratch);
+  for (size_t i = 0; i < local.size(); ++i) {
+    const string_view name = local.name(i);
+    for (size_t r = 0; r < repos.size(); ++r) {
+      const PackageView &repo = repos[r];
+      size_t &c = cursor[r];
+      /* Repos behind the winner catch up on a later package; each cursor
+       * still only ever moves forward. */
+      while (c < repo.size() && repo.name(c) < name) {
+        ++c;
+      }
+      if (c < repo.size() && repo.name(c) == name) {
+        /* Identical versions, by far the common case, need no vercmp. */
+        if (repo.version(c) != local.version(i)) {
+          updates.push_back({static_cast<uint32_t>(i),
+                             static_cast<uint32_t>(r),
+                             static_cast<uint32_t>(c)});
+        }
+        break;
+      }
+    }
+  }
+
+  /* Compare all matched versions in one go and keep the newer ones. */
+  pmr::vector<VersionPair> pairs(scratch);
+  pairs.reserve(updates.size() - first);
+  for (size_t u = first; u < updates.size(); ++u) {
+    const PendingUpdate &p = updates[u];
+    pairs.push_back({repos[p.repo].version(p.sync), local.version(p.local)});
+  }
+  pmr::vector<int> newer(pairs.size(), scratch);
+  vercmpBatch(pairs.data(), pairs.size(), newer.data());
+
+  size_t kept = first;
+  for (size_t p = 0; p < pairs.size(); ++p) {
+    if (newer[p] > 0) {
+      updates[kept++] = updates[first + p];
+    }
+  }
+  updates.resize(kept);
+}
+
+void UpdateDiff::foreign(const PackageView &local,
+                         const pmr::vector<PackageView> &repos,
+                         pmr::vector<uint32_t> &packages) {
+  pmr::vector<size_t> cursor(repos.size(), 0,
+                             packages.get_allocator().resource());
+  for (size_t i = 0; i < local.size(); ++i) {
+    const string_view name = local.name(i);
+    bool synced = false;
+    for (size_t r = 0; r < repos.size() && !synced; ++r) {
+      const PackageView &repo = repos[r];
+      size_t &c = cursor[r];
+      while (c < repo.size() && repo.name(c) < name) {
+        ++c;
+      }
+      synced = c < repo.size() && repo.name(c) == name;
+    }
+    if (!synced) {
+      packages.push_back(static_cast<uint32_t>(i));
+    }
+  }
+}
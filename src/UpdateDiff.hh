@@ -0,0 +1,38 @@
+#ifndef AARCHUP_UPDATEDIFF_H
+#define AARCHUP_UPDATEDIFF_H
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "PackageTable.hh"
+
+/* An installed package with a newer version in one of the sync repos. */
+struct PendingUpdate {
+  uint32_t local; /* index into the local view */
+  uint32_t repo;  /* index into the repo list */
+  uint32_t sync;  /* index into that repo's view */
+};
+
+/* Finds the upgradable packages by walking the name-sorted local view and
+ * all repo views in a single merge-join. Every view is visited front to
+ * back once and nothing is hashed or copied, so the cost stays linear in
+ * the total number of packages. */
+class UpdateDiff {
+ public:
+  /* repos must be in pacman.conf order: the first repo carrying a package
+   * is the one its version is taken from. Results are appended to updates
+   * in package name order. Scratch space comes from updates' memory
+   * resource. */
+  static void run(const PackageView &local,
+                  const std::pmr::vector<PackageView> &repos,
+                  std::pmr::vector<PendingUpdate> &updates);
+
+  /* Appends the local indexes of packages no repo carries, the ones pacman
+   * -Qm lists, in name order. */
+  static void foreign(const PackageView &local,
+                      const std::pmr::vector<PackageView> &repos,
+                      std::pmr::vector<uint32_t> &packages);
+};
+
+#endif
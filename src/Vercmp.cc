@@ -0,0 +1,158 @@
+#include "Vercmp.hh"
+
+using namespace std;
+
+/* ASCII classes as seen by alpm in the C locale. */
+static inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+static inline bool isAlpha(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static inline bool isAlnum(char c) { return isDigit(c) || isAlpha(c); }
+
+/* Port of alpm's rpmvercmp(). Each string is walked as alternating runs of
+ * separators and all-digit or all-alpha segments; the end of the view plays
+ * the part of the terminating NUL. */
+static int rpmvercmp(string_view a, string_view b) {
+  if (a == b) {
+    return 0;
+  }
+  const char *one = a.data();
+  const char *two = b.data();
+  const char *const end1 = one + a.size();
+  const char *const end2 = two + b.size();
+  const char *ptr1 = one;
+  const char *ptr2 = two;
+
+  while (one < end1 && two < end2) {
+    while (one < end1 && !isAlnum(*one)) {
+      ++one;
+    }
+    while (two < end2 && !isAlnum(*two)) {
+      ++two;
+    }
+    if (one == end1 || two == end2) {
+      break;
+    }
+    /* Separator runs of different length decide on their own. */
+    if (one - ptr1 != two - ptr2) {
+      return one - ptr1 < two - ptr2 ? -1 : 1;
+    }
+    ptr1 = one;
+    ptr2 = two;
+
+    bool isNum;
+    if (isDigit(*ptr1)) {
+      while (ptr1 < end1 && isDigit(*ptr1)) {
+        ++ptr1;
+      }
+      while (ptr2 < end2 && isDigit(*ptr2)) {
+        ++ptr2;
+      }
+      isNum = true;
+    } else {
+      while (ptr1 < end1 && isAlpha(*ptr1)) {
+        ++ptr1;
+      }
+      while (ptr2 < end2 && isAlpha(*ptr2)) {
+        ++ptr2;
+      }
+      isNum = false;
+    }
+
+    /* Segments of different type: numeric always beats alpha. */
+    if (two == ptr2) {
+      return isNum ? 1 : -1;
+    }
+
+    if (isNum) {
+      while (one < ptr1 && *one == '0') {
+        ++one;
+      }
+      while (two < ptr2 && *two == '0') {
+        ++two;
+      }
+      /* Whichever number has more digits wins. */
+      if (ptr1 - one != ptr2 - two) {
+        return ptr1 - one > ptr2 - two ? 1 : -1;
+      }
+    }
+
+    const int rc = string_view(one, static_cast<size_t>(ptr1 - one))
+                       .compare(string_view(two, static_cast<size_t>(ptr2 - two)));
+    if (rc != 0) {
+      return rc < 0 ? -1 : 1;
+    }
+    one = ptr1;
+    two = ptr2;
+  }
+
+  /* All segments equal, only the separators differed. */
+  if (one == end1 && two == end2) {
+    return 0;
+  }
+  /* A remaining alpha part never beats an empty string: if one is empty
+   * and two is not alpha, or one is alpha, two is newer. */
+  if ((one == end1 && !isAlpha(*two)) || (one < end1 && isAlpha(*one))) {
+    return -1;
+  }
+  return 1;
+}
+
+namespace {
+
+struct Evr {
+  string_view epoch;
+  string_view version;
+  string_view release;
+  bool hasRelease;
+};
+
+/* Port of alpm's parseEVR(): the epoch is a leading run of digits followed
+ * by ':', the release whatever follows the last '-' after it. */
+Evr parseEvr(string_view evr) {
+  Evr out;
+  size_t s = 0;
+  while (s < evr.size() && isDigit(evr[s])) {
+    ++s;
+  }
+  const size_t dash = evr.rfind('-');
+  const bool hasDash = dash != string_view::npos && dash >= s;
+  const size_t versionEnd = hasDash ? dash : evr.size();
+
+  if (s < evr.size() && evr[s] == ':') {
+    out.epoch = s == 0 ? string_view("0") : evr.substr(0, s);
+    out.version = evr.substr(s + 1, versionEnd > s ? versionEnd - s - 1 : 0);
+  } else {
+    out.epoch = "0";
+    out.version = evr.substr(0, versionEnd);
+  }
+  out.hasRelease = hasDash;
+  out.release = hasDash ? evr.substr(dash + 1) : string_view();
+  return out;
+}
+
+}  // namespace
+
+int vercmp(string_view a, string_view b) {
+  if (a == b) {
+    return 0;
+  }
+  const Evr evr1 = parseEvr(a);
+  const Evr evr2 = parseEvr(b);
+  int ret = rpmvercmp(evr1.epoch, evr2.epoch);
+  if (ret == 0) {
+    ret = rpmvercmp(evr1.version, evr2.version);
+    if (ret == 0 && evr1.hasRelease && evr2.hasRelease) {
+      ret = rpmvercmp(evr1.release, evr2.release);
+    }
+  }
+  return ret;
+}
+
+void vercmpBatch(const VersionPair *pairs, size_t count, int *results) {
+  for (size_t i = 0; i < count; ++i) {
+    results[i] = vercmp(pairs[i].a, pairs[i].b);
+  }
+}
@@ -0,0 +1,21 @@
+#ifndef AARCHUP_VERCMP_H
+#define AARCHUP_VERCMP_H
+
+#include <cstddef>
+#include <string_view>
+
+/* Compares two package versions ([epoch:]pkgver[-pkgrel]) exactly like
+ * libalpm's alpm_pkg_vercmp(): returns -1, 0 or 1 if a is older than,
+ * equal to or newer than b. Works on the views in place and never
+ * allocates. */
+int vercmp(std::string_view a, std::string_view b);
+
+struct VersionPair {
+  std::string_view a;
+  std::string_view b;
+};
+
+/* results[i] = vercmp(pairs[i].a, pairs[i].b) for count pairs. */
+void vercmpBatch(const VersionPair *pairs, size_t count, int *results);
+
+#endif
@@ -0,0 +1,36 @@
+#include "XdgDirs.hh"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+static string xdgDir(const char *variable, const char *fallback) {
+  const char *base = getenv(variable);
+  if (base && base[0] == '/') {
+    return string(base) + "/aarchup";
+  }
+  const char *home = getenv("HOME");
+  if (home && home[0]) {
+    return string(home) + fallback + "/aarchup";
+  }
+  return string();
+}
+
+string xdgCacheDir() { return xdgDir("XDG_CACHE_HOME", "/.cache"); }
+
+string xdgStateDir() { return xdgDir("XDG_STATE_HOME", "/.local/state"); }
+
+bool makeDirs(const string &path) {
+  if (path.empty()) {
+    return false;
+  }
+  for (size_t slash = path.find('/', 1); slash != string::npos;
+       slash = path.find('/', slash + 1)) {
+    if (mkdir(path.substr(0, slash).c_str(), 0755) != 0 && errno != EEXIST) {
+      return false;
+    }
+  }
+  return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
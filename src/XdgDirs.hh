@@ -0,0 +1,17 @@
+#ifndef AARCHUP_XDGDIRS_H
+#define AARCHUP_XDGDIRS_H
+
+#include <string>
+
+/* $XDG_CACHE_HOME/aarchup, or ~/.cache/aarchup. Empty if neither the
+ * variable nor $HOME is set. */
+std::string xdgCacheDir();
+
+/* $XDG_STATE_HOME/aarchup, or ~/.local/state/aarchup. Empty if neither the
+ * variable nor $HOME is set. */
+std::string xdgStateDir();
+
+/* Creates path and its missing parents, like mkdir -p. */
+bool makeDirs(const std::string &path);
+
+#endif
@@ -0,0 +1,88 @@
+#include <errno.h>
+#include <getopt.h>
+#include <plog/Formatters/BinaryFormatter.h>
+#include <plog/Formatters/CsvFormatter.h>
+#include <plog/Formatters/TxtFormatter.h>
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+/* Prints the usage and exits with status. */
+void print_help(int status) {
+  (status ? std::cerr : std::cout)
+      << "Usage: aarchup-logdump [options] file...\n"
+         "\n"
+         "Prints logs aarchup wrote with --log-file file.bin as text, the "
+         "files in the order given;\n"
+         "list rolled files oldest first, e.g. aarchup.2.bin aarchup.1.bin "
+         "aarchup.bin.\n"
+         "\n"
+         "Options:\n"
+         "          --csv                       Print CSV instead, as plog's "
+         "CsvFormatter does.\n"
+         "          --help|-h                   Print this help.\n";
+  exit(status);
+}
+
+/* Prints the records in fileName. Returns false if it couldn't be read or
+ * isn't a whole binary log; records before the damage are still printed. */
+bool dump(const char *fileName, bool csv) {
+  std::ifstream in(fileName, std::ios::binary);
+  if (!in) {
+    std::cerr << "aarchup-logdump: can't open '" << fileName << "': "
+              << strerror(errno) << "\n";
+    return false;
+  }
+  const std::string data((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+
+  plog::BinaryReader reader(data.data(), data.size());
+  const bool read = reader.read([csv](const plog::Record &record) {
+    std::cout << (csv ? plog::CsvFormatter::format(record)
+                      : plog::TxtFormatter::format(record));
+  });
+  if (!read) {
+    std::cerr << "aarchup-logdump: '" << fileName
+              << "' is not a binary log or was cut short\n";
+  }
+  return read;
+}
+
+int main(int argc, char **argv) {
+  int csv = 0;
+  const option long_opts[] = {
+      {"csv", no_argument, &csv, 1},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0},
+  };
+
+  while (true) {
+    const auto opt = getopt_long(argc, argv, "h", long_opts, nullptr);
+    if (-1 == opt) {
+      break;
+    }
+    switch (opt) {
+      case 0:
+        break;
+      case 'h':
+        print_help(0);
+        break;
+      default:
+        print_help(1);
+    }
+  }
+  if (optind == argc) {
+    print_help(1);
+  }
+
+  if (csv) {
+    std::cout << plog::CsvFormatter::header();
+  }
+  bool ok = true;
+  for (int i = optind; i < argc; ++i) {
+    ok = dump(argv[i], csv) && ok;
+  }
+  return ok ? 0 : 1;
+}
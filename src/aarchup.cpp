@@ -1,21 +1,63 @@
 #include <ctype.h>
 #include <getopt.h>
-#include <libnotify/notify.h>
+#include <gio/gio.h>
+#include <glib-unix.h>
+#include <plog/Appenders/AsyncAppender.h>
+#include <plog/Appenders/BinaryFileAppender.h>
 #include <plog/Appenders/ConsoleAppender.h>
+#include <plog/Appenders/JournaldAppender.h>
+#include <plog/Appenders/RollingFileAppender.h>
 #include <plog/Log.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
+#include <charconv>
+#include <chrono>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include "AllocCounter.hh"
+#include "Arena.hh"
+#include "AurBackend.hh"
+#include "AurClient.hh"
+#include "CheckState.hh"
 #include "CliWrapper.hh"
+#include "LineBuffer.hh"
+#include "Metrics.hh"
+#include "NativeBackend.hh"
+#include "Notifier.hh"
+#include "PacmanConf.hh"
+#include "PacmanWatcher.hh"
+#include "XdgDirs.hh"
 
-#define AUR_HEADER "AUR updates:\n"
+#define UPDATES_HEADER "There are updates for:"
+#define AUR_HEADER "AUR updates:"
 #define VERSION_NUMBER "2.1.0"
 
+/* Long-only options */
+enum {
+  OPT_COMMAND_TIMEOUT = 256,
+  OPT_AUR_TIMEOUT,
+  OPT_NATIVE,
+  OPT_DBPATH,
+  OPT_PACMAN_CONF,
+  OPT_WATCH,
+  OPT_AUR_URL,
+  OPT_AUR_CACHE_TTL,
+  OPT_METRICS_FILE,
+  OPT_SUMMARY,
+  OPT_JOURNAL,
+  OPT_LOG_FILE
+};
+
 /* Prints the help. */
 int print_help() {
   std::cout
@@ -25,6 +67,11 @@ int print_help() {
          "out the list of updates.\n"
          "                                      The default is "
          "/usr/bin/checkupdates\n"
+         "                                      It is run directly, not "
+         "through a shell: quotes and backslashes\n"
+         "                                      group words, but pipes, "
+         "redirections, && and VAR=value don't work.\n"
+         "                                      Use sh -c '...' for those.\n"
          "          --icon|-p [value]           Shows the icon, whose path has "
          "been given as value, in the notification.\n"
          "                                      By default no icon is shown.\n"
@@ -40,7 +87,7 @@ int print_help() {
          "of the user who started aarchup.\n"
          "                                      !!You should change this if "
          "root is executing aarchup!!\n"
-         "          --urgency|-u [value]        Set the libnotify "
+         "          --urgency|-u [value]        Set the notification "
          "urgency-level. Possible values are: low, normal and critical.\n"
          "                                      The default value is normal. "
          "With changing this value you can change the color of the "
@@ -56,6 +103,56 @@ int print_help() {
          "          --version|-v                Shows the version.\n"
          "          --aur                       Check aur for new packages "
          "too. Will need auracle installed.\n"
+         "          --command-timeout [value]   Kill the update command and "
+         "everything it started after this many seconds.\n"
+         "                                      The default value is 300 "
+         "seconds, 0 waits forever.\n"
+         "          --aur-timeout [value]       Same as --command-timeout for "
+         "the AUR check.\n"
+         "          --native                    Read pacman's databases "
+         "directly instead of running --command.\n"
+         "                                      With --aur the AUR is queried "
+         "directly too, instead of running auracle.\n"
+         "                                      The sync databases are used "
+         "as they are, so they need to be refreshed\n"
+         "                                      by other means. --command is "
+         "still used if they can't be read.\n"
+         "          --aur-url [value]           AUR RPC info endpoint for "
+         "--native --aur.\n"
+         "                                      The default is "
+         "https://aur.archlinux.org/rpc/v5/info\n"
+         "          --aur-cache-ttl [value]     Minutes AUR versions are "
+         "answered from the cache before asking again.\n"
+         "                                      The default value is 60, 0 "
+         "disables the cache.\n"
+         "          --dbpath [value]            Database directory for "
+         "--native. The default is DBPath from pacman.conf.\n"
+         "          --pacman-conf [value]       pacman.conf to read with "
+         "--native. The default is /etc/pacman.conf\n"
+         "          --watch                     Check again as soon as pacman "
+         "installs, removes or syncs packages.\n"
+         "                                      Implies --loop-time, which "
+         "stays the upper bound between checks.\n"
+         "          --capture-memfd             Let the commands write their "
+         "output to a memory file instead of a pipe.\n"
+         "          --summary                   Start the notification with "
+         "the number of updates per repo and how many are shown,\n"
+         "                                      e.g. \"120 updates (core 3, "
+         "extra 110, AUR 7), showing first 29\".\n"
+         "          --metrics-file [value]      Write Prometheus metrics to "
+         "this file after every check,\n"
+         "                                      for node_exporter's textfile "
+         "collector.\n"
+         "          --journal                   Log to the systemd journal, "
+         "with BACKEND, DURATION_US and other fields\n"
+         "                                      to filter on. Logs to the "
+         "console if there is no journal.\n"
+         "          --log-file [value]          Also log to this file, rolled "
+         "at 1 MiB with 3 files kept.\n"
+         "                                      Written once per 64 KiB, "
+         "second or warning rather than per record.\n"
+         "                                      A .bin file is written in "
+         "plog's binary format, for aarchup-logdump.\n"
          "          --debug|-d                  Print debug info.\n"
          "          --ftimeout|-f [value]       Program will manually enforce "
          "timeout for closing notification.\n"
@@ -79,33 +176,681 @@ int print_version() {
   exit(0);
 }
 
-std::vector<std::string> split(const std::string &s, char delimiter) {
-  std::vector<std::string> tokens;
-  std::string token;
-  std::istringstream tokenStream(s);
-  while (std::getline(tokenStream, token, delimiter)) {
-    tokens.push_back(token);
+/* Runs a backend, streaming the first lines of its output into lines, and
+ * logs how it exited. */
+void run_backend(CliWrapper &backend, const char *name, LineBuffer &lines,
+                 BackendRun &run) {
+  CliResult result;
+  run.source = "command";
+  try {
+    result = backend.execute(
+        [&lines](std::string_view line) { return lines.addLine(line); });
+  } catch (const std::exception &e) {
+    LOGE << e.what();
+    lines.clear();
+    return;
+  }
+  LOGD << "Command '" << name << "' exited with status " << result.exitStatus
+       << " after writing " << result.bytesRead << " bytes";
+  run.exitStatus = result.exitStatus;
+  run.bytesRead = result.bytesRead;
+  /* Lines past the buffer are only counted, as pending updates. */
+  run.updates = static_cast<size_t>(lines.seen()) + result.skippedLines;
+  if (result.truncated) {
+    LOGW << "Output of '" << name << "' exceeded " << backend.maxOutput()
+         << " bytes, the rest was dropped";
+  }
+  if (result.timedOut) {
+    LOGW << "Command '" << name << "' did not finish in time and was killed";
+    lines.clear();
+    return;
+  }
+  if (result.exitStatus > 128) {
+    LOGW << "Command '" << name << "' was killed by signal "
+         << result.exitStatus - 128;
   }
-  return tokens;
 }
 
-int main(int argc, char **argv) {
-  NotifyUrgency urgency = NOTIFY_URGENCY_NORMAL;
+/* Loads pacman.conf, with dbpath overriding its DBPath when set. */
+PacmanConf load_pacman_conf(const char *pacman_conf, const char *dbpath) {
+  PacmanConf conf = PacmanConf::load(pacman_conf);
+  if (dbpath) {
+    conf.dbPath = dbpath;
+    if (conf.dbPath.back() != '/') {
+      conf.dbPath += '/';
+    }
+  }
+  return conf;
+}
+
+/* Writes state to statePath, creating its directory first. */
+void save_state(const CheckState &state, const std::string &statePath) {
+  if (statePath.empty()) {
+    return;
+  }
+  if (!makeDirs(xdgStateDir()) || !state.save(statePath)) {
+    LOGW << "Failed to write state file '" << statePath << "'";
+  }
+}
+
+/* Queries the AUR for updates to the foreign packages into lines. Returns
+ * how many there are. */
+size_t run_aur_native(const PackageTable &foreign, const char *aur_url,
+                      long aur_timeout, long aur_cache_ttl,
+                      GCancellable *cancellable, LineBuffer &lines) {
+  AurBackend backend(xdgCacheDir(), aur_url);
+  backend.setTimeout(std::chrono::seconds(aur_timeout));
+  backend.setCacheTtl(std::chrono::seconds(aur_cache_ttl));
+  backend.setCancellable(cancellable);
+  const size_t updates = backend.check(
+      foreign, [&lines](std::string_view line) { return lines.addLine(line); });
+  LOGD << "Found " << updates << " updates in the AUR";
+  return updates;
+}
+
+/* Command line settings. */
+struct Options {
+  Notifier::Urgency urgency = Notifier::Urgency::Normal;
   const char *command = "/usr/bin/checkupdates";
   const char *aurCommand = "/usr/bin/auracle sync";
+  const char *pacman_conf = PacmanConf::DEFAULT_PATH;
+  const char *dbpath = nullptr;
+  const char *aur_url = AurClient::DEFAULT_URL;
+  const char *metrics_file = nullptr;
+  const char *log_file = nullptr;
 
   long timeout = 3600 * 1000;
   long max_number_out = 30;
   long loop_time = 3600;
   long manual_timeout = 0;
+  long command_timeout = 300;
+  long aur_timeout = 300;
+  long aur_cache_ttl = 3600;
   gchar *icon = nullptr;
-  bool will_loop = FALSE;
+  bool will_loop = false;
+  int aur = 0;
+  int memfd_capture = 0;
+  bool native = false;
+  bool watch = false;
+  bool summary = false;
+};
+
+/* One check, run on a worker thread and handed back to the loop. A loop
+ * keeps a single job and resets it for every check, so the buffers,
+ * commands and backend of the last check are reused instead of allocated
+ * again. */
+struct CheckJob {
+  const Options &opts;
+  /* Per-check memory of the repo backend and the notification body. The
+   * worker and then the main thread use it, never both at once. */
+  Arena arena;
+  LineBuffer repo;
+  LineBuffer aur;
+  BackendRun repoRun;
+  BackendRun aurRun;
+  double seconds = 0;
+  /* Set up by the first check that needs them, under commandsMutex so
+   * cancel() can reach them. */
+  std::mutex commandsMutex;
+  std::optional<CliWrapper> repoCommand;
+  std::optional<CliWrapper> aurCommand;
+  /* Cancelled for good by cancel(). */
+  GCancellable *cancellable;
+  std::optional<NativeBackend> native;
+  struct timespec pacmanConfTime = {0, 0};
+  /* The foreign packages for the AUR check, from the repo check's read of
+   * the databases. */
+  PackageTable foreign;
+
+  explicit CheckJob(const Options &options)
+      : opts(options),
+        repo(options.max_number_out),
+        aur(options.max_number_out),
+        cancellable(g_cancellable_new()) {}
+  CheckJob(const CheckJob &) = delete;
+  CheckJob &operator=(const CheckJob &) = delete;
+  ~CheckJob() { g_object_unref(cancellable); }
+
+  /* Makes a running check return as soon as it can: kills the commands'
+   * process groups and aborts AUR requests. Called from the main thread
+   * while the worker runs the check. */
+  void cancel() {
+    g_cancellable_cancel(cancellable);
+    std::lock_guard<std::mutex> lock(commandsMutex);
+    if (repoCommand) {
+      repoCommand->cancel();
+    }
+    if (aurCommand) {
+      aurCommand->cancel();
+    }
+  }
+
+  bool cancelled() const { return g_cancellable_is_cancelled(cancellable); }
+
+  /* Forgets the last check's results and memory. */
+  void reset() {
+    arena.reset();
+    repo.clear();
+    aur.clear();
+    repoRun.clear();
+    aurRun.clear();
+    seconds = 0;
+  }
+};
+
+/* Everything the main loop callbacks share. Only touched from the main
+ * thread; a check's worker thread gets just the options and its lines. */
+struct App {
+  Options opts;
+  CheckState state;
+  std::string statePath;
+  std::unique_ptr<Notifier> notifier;
+  Metrics metrics;
+  std::unique_ptr<PacmanWatcher> watcher;
+  std::unique_ptr<CheckJob> job;
+  /* AllocCounter::count() when the running check started. */
+  uint64_t allocations = 0;
+  GMainLoop *loop = nullptr;
+  guint checkTimer = 0;
+  guint closeTimer = 0;
+  guint settleTimer = 0;
+  /* on_pacman_settled calls that found db.lck since the last event. */
+  unsigned lockedPolls = 0;
+  bool checking = false;
+  bool checkPending = false;
+  /* Set once SIGINT or SIGTERM came; no check starts after it. */
+  bool quitting = false;
+};
+
+/* job's command for cli, created on first use. */
+CliWrapper &backend_command(CheckJob &job, std::optional<CliWrapper> &command,
+                            const char *cli, bool memfd, long timeout) {
+  std::lock_guard<std::mutex> lock(job.commandsMutex);
+  if (!command) {
+    command.emplace(cli);
+    command->setUseMemfd(memfd);
+    command->setTimeout(std::chrono::seconds(timeout));
+    if (job.cancelled()) {
+      command->cancel();
+    }
+  }
+  return *command;
+}
+
+/* Reads pending repo updates from pacman's databases into job's repo
+ * lines, the databases themselves into its arena, and the foreign packages
+ * into job's foreign if wanted. Returns how many updates there are.
+ * pacman.conf is only parsed again once it changed. */
+size_t run_native(CheckJob &job, bool wantForeign) {
+  const Options &opts = job.opts;
+  struct stat confStat;
+  const bool statted = stat(opts.pacman_conf, &confStat) == 0;
+  if (!job.native || !statted ||
+      confStat.st_mtim.tv_sec != job.pacmanConfTime.tv_sec ||
+      confStat.st_mtim.tv_nsec != job.pacmanConfTime.tv_nsec) {
+    job.native.reset();
+    job.native.emplace(load_pacman_conf(opts.pacman_conf, opts.dbpath),
+                       xdgCacheDir());
+    job.pacmanConfTime = confStat.st_mtim;
+  }
+  LineBuffer &lines = job.repo;
+  const size_t updates = job.native->check(
+      [&lines](std::string_view line) { return lines.addLine(line); },
+      &job.repoRun.repos, wantForeign ? &job.foreign : nullptr, &job.arena);
+  LOGD << "Found " << updates << " updates in the sync databases";
+  return updates;
+}
+
+/* Runs the backends and collects their first lines into job. Blocks for as
+ * long as the slower backend takes. */
+void run_check(CheckJob &job) {
+  const Options &opts = job.opts;
+  LineBuffer &checkUpdateLines = job.repo;
+  LineBuffer &aurHelperLines = job.aur;
+  BackendRun &repoRun = job.repoRun;
+  BackendRun &aurRun = job.aurRun;
+  /* Both backends are network bound, run the AUR one alongside so a
+   * check takes as long as the slower of the two. The native AUR check
+   * waits for the foreign packages the native repo check reads, so the
+   * databases are read once per check; if that fails, both fall back to
+   * their commands. The promise only exists then: its shared state, and
+   * the broken promise an unset one leaves behind, are heap allocations. */
+  std::future<void> aurHelperFuture;
+  std::optional<std::promise<void>> foreignPromise;
+  std::future<void> foreignReady;
+  if (opts.native && opts.aur) {
+    foreignPromise.emplace();
+    foreignReady = foreignPromise->get_future();
+  }
+  if (opts.aur) {
+    CliWrapper &aurHelperCmd =
+        backend_command(job, job.aurCommand, opts.aurCommand,
+                        opts.memfd_capture, opts.aur_timeout);
+    aurHelperFuture = std::async(std::launch::async, [&]() {
+      const auto start = std::chrono::steady_clock::now();
+      bool checked = false;
+      if (opts.native) {
+        LOGD << "Querying '" << opts.aur_url << "' for AUR updates";
+        try {
+          foreignReady.get();
+          aurRun.updates =
+              run_aur_native(job.foreign, opts.aur_url, opts.aur_timeout,
+                             opts.aur_cache_ttl, job.cancellable,
+                             aurHelperLines);
+          aurRun.source = "native";
+          aurRun.exitStatus = 0;
+          checked = true;
+        } catch (const std::exception &e) {
+          if (!job.cancelled()) {
+            LOGW << "Querying the AUR failed, falling back to '"
+                 << opts.aurCommand << "': " << e.what();
+          }
+          aurHelperLines.clear();
+        }
+      }
+      if (!checked && !job.cancelled()) {
+        LOGD << "Executing command '" << opts.aurCommand << "' for AUR updates";
+        run_backend(aurHelperCmd, opts.aurCommand, aurHelperLines, aurRun);
+      }
+      aurRun.seconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+    });
+  }
+  const auto start = std::chrono::steady_clock::now();
+  bool checked = false;
+  if (opts.native) {
+    LOGD << "Reading pacman databases for updates";
+    try {
+      repoRun.updates = run_native(job, opts.aur);
+      if (foreignPromise) {
+        foreignPromise->set_value();
+      }
+      repoRun.source = "native";
+      repoRun.exitStatus = 0;
+      checked = true;
+    } catch (const std::exception &e) {
+      if (foreignPromise) {
+        foreignPromise->set_exception(std::current_exception());
+      }
+      LOGW << "Reading pacman databases failed, falling back to '"
+           << opts.command << "': " << e.what();
+      checkUpdateLines.clear();
+      repoRun.repos.clear();
+    }
+  }
+  if (!checked && !job.cancelled()) {
+    LOGD << "Executing command '" << opts.command << "' for updates";
+    run_backend(backend_command(job, job.repoCommand, opts.command,
+                                opts.memfd_capture, opts.command_timeout),
+                opts.command, checkUpdateLines, repoRun);
+  }
+  repoRun.seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  if (aurHelperFuture.valid()) {
+    aurHelperFuture.get();
+  }
+}
+
+void write_metrics(const App &app) {
+  if (app.opts.metrics_file && !app.metrics.write(app.opts.metrics_file)) {
+    LOGW << "Failed to write metrics file '" << app.opts.metrics_file << "'";
+  }
+}
+
+/* Closes the current notification, if any. */
+void close_notification(App &app) {
+  if (app.closeTimer) {
+    g_source_remove(app.closeTimer);
+    app.closeTimer = 0;
+  }
+  if (!app.state.notificationId) {
+    return;
+  }
+  app.notifier->close(app.state.notificationId, [](const std::string &error) {
+    if (error.empty()) {
+      LOGD << "Notification closed";
+    } else {
+      LOGW << "Failed to close, reason:\n\t" << error;
+    }
+  });
+}
+
+gboolean on_close_timeout(gpointer data) {
+  App &app = *static_cast<App *>(data);
+  app.closeTimer = 0;
+  LOGD << "--ftimeout reached";
+  close_notification(app);
+  return G_SOURCE_REMOVE;
+}
+
+void on_notification_closed(App &app, uint32_t id) {
+  if (id != app.state.notificationId) {
+    return;
+  }
+  LOGD << "Notification was closed";
+  if (app.closeTimer) {
+    g_source_remove(app.closeTimer);
+    app.closeTimer = 0;
+  }
+}
+
+/* The daemon that showed the notification is gone, its id could now name
+ * somebody else's notification. */
+void on_notifier_restart(App &app) {
+  LOGI << "Notification daemon restarted";
+  if (app.state.notificationId) {
+    app.state.notificationId = 0;
+    save_state(app.state, app.statePath);
+  }
+}
+
+void on_notification_shown(App &app, uint64_t fingerprint, uint32_t id,
+                           const std::string &error) {
+  app.metrics.recordNotification(id != 0);
+  write_metrics(app);
+  if (!id) {
+    LOGE << "Notification failed, reason:\n\t" << error;
+    return;
+  }
+  LOGD << "Notification shown successfully";
+  if (fingerprint != app.state.fingerprint || id != app.state.notificationId) {
+    app.state.fingerprint = fingerprint;
+    app.state.notificationId = id;
+    save_state(app.state, app.statePath);
+  }
+  if (app.opts.manual_timeout && app.opts.will_loop) {
+    LOGD << "Will close notification in " << app.opts.manual_timeout / 60
+         << " minutes";
+    if (app.closeTimer) {
+      g_source_remove(app.closeTimer);
+    }
+    app.closeTimer = g_timeout_add_seconds(
+        static_cast<guint>(app.opts.manual_timeout), on_close_timeout, &app);
+  }
+}
+
+/* Appends n to out in decimal. */
+void append_number(std::pmr::string &out, size_t n) {
+  char digits[24];
+  const auto end = std::to_chars(digits, digits + sizeof(digits), n).ptr;
+  out.append(digits, static_cast<size_t>(end - digits));
+}
+
+/* "N updates (core X, extra Y, AUR Z), showing first M" for --summary.
+ * Repos without updates are left out; a command backend only has a
+ * total. */
+void summary_line(const CheckJob &job, long shown, std::pmr::string &out) {
+  const size_t total = job.repoRun.updates + job.aurRun.updates;
+  append_number(out, total);
+  out += total == 1 ? " update (" : " updates (";
+  const char *separator = "";
+  if (job.repoRun.repos.empty() && job.repoRun.updates) {
+    out += "repos ";
+    append_number(out, job.repoRun.updates);
+    separator = ", ";
+  }
+  for (const auto &repo : job.repoRun.repos) {
+    if (repo.second) {
+      out += separator;
+      out += repo.first;
+      out += ' ';
+      append_number(out, repo.second);
+      separator = ", ";
+    }
+  }
+  if (job.aurRun.updates) {
+    out += separator;
+    out += "AUR ";
+    append_number(out, job.aurRun.updates);
+  }
+  out += ')';
+  if (static_cast<size_t>(shown) < total) {
+    out += ", showing first ";
+    append_number(out, static_cast<size_t>(shown));
+  }
+}
+
+/* Shows, updates or closes the notification for a finished check. The
+ * calls are asynchronous, the state is saved once the server answered.
+ * The body is built in the job's arena. */
+void show_updates(App &app, CheckJob &job) {
+  const Options &opts = app.opts;
+  CheckState &state = app.state;
+  const char *category = "update";
+
+  const bool updates = !job.repo.empty() || !job.aur.empty();
+  LineBuffer body(opts.max_number_out, &job.arena);
+  std::pmr::string text(&job.arena);
+  if (updates) {
+    body.addLine(UPDATES_HEADER);
+    long shown = body.lines();
+    body.append(job.repo);
+    shown = body.lines() - shown;
+    if (!job.aur.empty()) {
+      body.addLine(AUR_HEADER);
+      const long before = body.lines();
+      body.append(job.aur);
+      shown += body.lines() - before;
+    }
+    if (opts.summary) {
+      /* Takes the header's place, so --maxentries means the same. */
+      summary_line(job, shown, text);
+      text.append(body.str(), strlen(UPDATES_HEADER));
+    } else {
+      text = body.str();
+    }
+  }
+  const uint64_t fingerprint = updates ? CheckState::fingerprintOf(text) : 0;
+  if (updates && !opts.will_loop && fingerprint == state.fingerprint) {
+    /* A timer run with nothing new; showing it again would only stack a
+     * duplicate. */
+    LOGI << "Updates unchanged since the last run, not notifying again";
+  } else if (updates) {
+    /* Replaces what an earlier check or run showed instead of adding one. */
+    app.notifier->show(
+        state.notificationId, "New updates for Arch Linux available!",
+        text.c_str(), opts.icon, category, opts.urgency,
+        static_cast<int>(opts.timeout),
+        [&app, fingerprint](uint32_t id, const std::string &error) {
+          on_notification_shown(app, fingerprint, id, error);
+        });
+  } else {
+    LOGI << "No updates found";
+    if (state.notificationId) {
+      LOGD << "Previous notification found. Closing it in case it was "
+              "still opened";
+      close_notification(app);
+    }
+    if (state.fingerprint || state.notificationId) {
+      state = CheckState();
+      save_state(state, app.statePath);
+    }
+  }
+}
+
+void start_check(App &app);
+
+gboolean on_check_timer(gpointer data) {
+  App &app = *static_cast<App *>(data);
+  app.checkTimer = 0;
+  start_check(app);
+  return G_SOURCE_REMOVE;
+}
+
+/* Runs job's check and times it. */
+void run_job(CheckJob &job) {
+  const auto start = std::chrono::steady_clock::now();
+  run_check(job);
+  job.seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+}
+
+/* Logs how backend ("repo" or "aur") did, with fields for the journal. */
+void log_backend_run(const char *backend, const BackendRun &run) {
+  if (!run.source) {
+    return;
+  }
+  LOGI << plog::field("BACKEND", backend) << plog::field("SOURCE", run.source)
+       << plog::field("UPDATES", run.updates)
+       << plog::field("EXIT_STATUS", run.exitStatus)
+       << plog::field("DURATION_US",
+                      static_cast<long long>(run.seconds * 1000000))
+       << "Checking " << backend << " updates (" << run.source << ") found "
+       << run.updates << " in " << run.seconds << "s";
+}
+
+/* Notifies about a finished check and records it. */
+void finish_check(App &app, CheckJob &job) {
+  log_backend_run("repo", job.repoRun);
+  log_backend_run("aur", job.aurRun);
+  app.metrics.recordCheck(job.repoRun, job.aurRun, job.seconds);
+  show_updates(app, job);
+  if (AllocCounter::enabled()) {
+    /* Log records made with --debug count too. */
+    const uint64_t allocations = AllocCounter::count() - app.allocations;
+    app.metrics.recordAllocations(allocations);
+    LOGD << "Check made " << allocations << " heap allocations, arena peak "
+         << job.arena.peak() << " bytes";
+  }
+  write_metrics(app);
+}
+
+void check_thread(GTask *task, gpointer, gpointer taskData, GCancellable *) {
+  run_job(*static_cast<CheckJob *>(taskData));
+  g_task_return_boolean(task, TRUE);
+}
+
+void on_check_done(GObject *, GAsyncResult *result, gpointer data) {
+  App &app = *static_cast<App *>(data);
+  auto &job = *static_cast<CheckJob *>(g_task_get_task_data(G_TASK(result)));
+  if (app.quitting) {
+    /* Cancelled; main() only waits for the worker to let go of job. */
+    app.checking = false;
+    return;
+  }
+  finish_check(app, job);
+  app.checking = false;
+  if (app.checkPending) {
+    app.checkPending = false;
+    start_check(app);
+    return;
+  }
+  LOGD << "Next run will be in " << app.opts.loop_time / 60 << " minutes";
+  app.checkTimer = g_timeout_add_seconds(
+      static_cast<guint>(app.opts.loop_time), on_check_timer, &app);
+}
+
+/* Runs a check on a worker thread, or queues one if a check is already
+ * running. Any scheduled check is replaced, so --loop-time counts from the
+ * last check. */
+void start_check(App &app) {
+  if (app.quitting) {
+    return;
+  }
+  if (app.checkTimer) {
+    g_source_remove(app.checkTimer);
+    app.checkTimer = 0;
+  }
+  if (app.checking) {
+    app.checkPending = true;
+    return;
+  }
+  app.checking = true;
+  app.allocations = AllocCounter::count();
+  if (!app.job) {
+    app.job = std::make_unique<CheckJob>(app.opts);
+  }
+  app.job->reset();
+  GTask *task = g_task_new(nullptr, nullptr, on_check_done, &app);
+  g_task_set_task_data(task, app.job.get(), nullptr);
+  g_task_run_in_thread(task, check_thread);
+  g_object_unref(task);
+}
+
+/* pacman is done once nothing happened for a while and db.lck is gone, or
+ * has been there for so long that it must be stale. */
+gboolean on_pacman_settled(gpointer data) {
+  App &app = *static_cast<App *>(data);
+  if (app.watcher->locked()) {
+    if (++app.lockedPolls <
+        PacmanWatcher::STALE_LOCK / PacmanWatcher::DEFAULT_QUIET) {
+      return G_SOURCE_CONTINUE;
+    }
+    LOGW << "db.lck is still there "
+         << std::chrono::duration_cast<std::chrono::minutes>(
+                PacmanWatcher::STALE_LOCK)
+                .count()
+         << " minutes after pacman last touched the databases, it looks "
+            "stale; checking anyway";
+  }
+  app.settleTimer = 0;
+  app.lockedPolls = 0;
+  LOGD << "pacman databases changed, checking again";
+  start_check(app);
+  return G_SOURCE_REMOVE;
+}
+
+gboolean on_pacman_event(gint, GIOCondition, gpointer data) {
+  App &app = *static_cast<App *>(data);
+  app.watcher->drain();
+  /* Every event of a burst pushes the check back. */
+  if (app.settleTimer) {
+    g_source_remove(app.settleTimer);
+  }
+  app.lockedPolls = 0;
+  app.settleTimer = g_timeout_add(
+      static_cast<guint>(PacmanWatcher::DEFAULT_QUIET.count()),
+      on_pacman_settled, &app);
+  return G_SOURCE_CONTINUE;
+}
+
+gboolean on_quit_signal(gpointer data) {
+  App &app = *static_cast<App *>(data);
+  if (app.checking && !app.quitting) {
+    LOGD << "Cancelling the running check";
+    app.job->cancel();
+  }
+  app.quitting = true;
+  g_main_loop_quit(app.loop);
+  return G_SOURCE_CONTINUE;
+}
+
+gboolean on_check_signal(gpointer data) {
+  App &app = *static_cast<App *>(data);
+  LOGD << "SIGHUP received, checking now";
+  start_check(app);
+  return G_SOURCE_CONTINUE;
+}
+
+int main(int argc, char **argv) {
   static int help_flag = 0;
   static int version_flag = 0;
-  static int aur = 0;
+  App app;
+  Options &opts = app.opts;
+
+  /* Looked for ahead of parsing, so the options' own records already go
+   * where --journal says. */
+  bool journal = false;
+  for (int i = 1; i < argc && strcmp(argv[i], "--") != 0; ++i) {
+    if (strcmp(argv[i], "--journal") == 0) {
+      journal = true;
+    }
+  }
 
-  plog::ConsoleAppender<plog::TxtFormatter> consoleAppender;
-  plog::init(plog::warning, &consoleAppender);
+  /* Formatting and writing happen on the appender's own thread, so a
+   * stalled terminal or journal doesn't hold up checks. Static, so
+   * whatever is queued still gets written when exit() is called. */
+  static plog::ConsoleAppender<plog::TxtFormatter> consoleAppender;
+  plog::IAppender *appender = &consoleAppender;
+  if (journal) {
+    static plog::JournaldAppender journaldAppender("aarchup", &consoleAppender);
+    appender = &journaldAppender;
+  }
+  static plog::AsyncAppender asyncAppender(appender);
+  plog::init(plog::warning, &asyncAppender);
 
   if (argc > 1) {
     if (strcmp(argv[1], "--version") == 0 || strcmp(argv[1], "-v") == 0)
@@ -126,7 +871,20 @@ int main(int argc, char **argv) {
       {"loop-time", required_argument, nullptr, 'l'},
       {"help", no_argument, &help_flag, 1},
       {"version", no_argument, &version_flag, 1},
-      {"aur", no_argument, &aur, 1},
+      {"aur", no_argument, &opts.aur, 1},
+      {"capture-memfd", no_argument, &opts.memfd_capture, 1},
+      {"command-timeout", required_argument, nullptr, OPT_COMMAND_TIMEOUT},
+      {"aur-timeout", required_argument, nullptr, OPT_AUR_TIMEOUT},
+      {"native", no_argument, nullptr, OPT_NATIVE},
+      {"dbpath", required_argument, nullptr, OPT_DBPATH},
+      {"pacman-conf", required_argument, nullptr, OPT_PACMAN_CONF},
+      {"watch", no_argument, nullptr, OPT_WATCH},
+      {"aur-url", required_argument, nullptr, OPT_AUR_URL},
+      {"aur-cache-ttl", required_argument, nullptr, OPT_AUR_CACHE_TTL},
+      {"metrics-file", required_argument, nullptr, OPT_METRICS_FILE},
+      {"summary", no_argument, nullptr, OPT_SUMMARY},
+      {"journal", no_argument, nullptr, OPT_JOURNAL},
+      {"log-file", required_argument, nullptr, OPT_LOG_FILE},
       {"ftimeout", required_argument, nullptr, 'f'},
       {"debug", no_argument, nullptr, 'd'},
       {nullptr, 0, nullptr, 0},
@@ -143,6 +901,10 @@ int main(int argc, char **argv) {
     switch (opt) {
       case 'd':
         plog::get()->setMaxSeverity(plog::verbose);
+        if (!plog::isCompiledIn(plog::debug)) {
+          LOGW << "Debug logging was left out of this build, --debug shows "
+                  "nothing more";
+        }
         break;
       case 0:
         if (long_opts[option_index].flag) {
@@ -158,28 +920,33 @@ int main(int argc, char **argv) {
         print_version();
         break;
       case 'c':
-        command = optarg;
-        LOGV << "Command set: '" << command << "'";
+        opts.command = optarg;
+        LOGV << "Command set: '" << opts.command << "'";
+        if (CliWrapper::looksLikeShell(opts.command)) {
+          LOGW << "'" << opts.command << "' is run without a shell, so its "
+               << "pipes, redirections and assignments won't work; wrap it "
+               << "in sh -c '...'";
+        }
         break;
       case 'p':
-        icon = optarg;
-        LOGV << "Icon set: '" << icon << "'";
+        opts.icon = optarg;
+        LOGV << "Icon set: '" << opts.icon << "'";
         break;
       case 'm':
         if (!isdigit(optarg[0])) {
           LOGF << "Argument '--maxentries' should be number";
           exit(1);
         }
-        max_number_out = std::stol(optarg);
-        LOGV << "Max_number set: '" << max_number_out << "' lines";
+        opts.max_number_out = std::stol(optarg);
+        LOGV << "Max_number set: '" << opts.max_number_out << "' lines";
         break;
       case 't':
         if (!isdigit(optarg[0])) {
           LOGF << "Argument '--timeout' should be number";
           exit(1);
         }
-        timeout = std::stol(optarg) * 1000;
-        LOGV << "Timeout set: " << timeout / 1000 << " sec(s)";
+        opts.timeout = std::stol(optarg) * 1000;
+        LOGV << "Timeout set: " << opts.timeout / 1000 << " sec(s)";
         ;
         break;
       case 'i':
@@ -195,43 +962,104 @@ int main(int argc, char **argv) {
         break;
       case 'u':
         if (strcmp(optarg, "low") == 0) {
-          urgency = NOTIFY_URGENCY_LOW;
+          opts.urgency = Notifier::Urgency::Low;
         } else if (strcmp(optarg, "normal") == 0) {
-          urgency = NOTIFY_URGENCY_NORMAL;
+          opts.urgency = Notifier::Urgency::Normal;
         } else if (strcmp(optarg, "critical") == 0) {
-          urgency = NOTIFY_URGENCY_CRITICAL;
+          opts.urgency = Notifier::Urgency::Critical;
         } else {
           LOGF << "Argument '--urgency' has to be 'low', 'normal' or 'critical";
           exit(1);
         }
-        LOGV << "Urgency set: " << urgency;
+        LOGV << "Urgency set: " << optarg;
         break;
       case 'l':
-        will_loop = TRUE;
+        opts.will_loop = TRUE;
         if (!isdigit(optarg[0])) {
           LOGF << "Argument '--loop-time' should be number";
           exit(1);
         }
-        loop_time = std::stol(optarg) * 60;
-        LOGV << "Loop_time set: " << loop_time / 60 << " min(s)";
+        opts.loop_time = std::stol(optarg) * 60;
+        LOGV << "Loop_time set: " << opts.loop_time / 60 << " min(s)";
         break;
       case 'f':
         if (!isdigit(optarg[0])) {
           LOGF << "Argument '--ftimeout' should be number";
           exit(1);
         }
-        manual_timeout = std::stol(optarg) * 60;
-        if (!will_loop) {
+        opts.manual_timeout = std::stol(optarg) * 60;
+        if (!opts.will_loop) {
           LOGF << "Argument '--ftimeout' can't be used without or before "
                   "'--loop-time'";
           exit(1);
         }
-        if (manual_timeout > loop_time) {
+        if (opts.manual_timeout > opts.loop_time) {
           LOGF << "Please set a value for '--ftimeout' that is lower than "
                   "'--loop-time'";
           exit(1);
         }
-        LOGV << "Manual_timeout: " << manual_timeout / 60 << " min(s)";
+        LOGV << "Manual_timeout: " << opts.manual_timeout / 60 << " min(s)";
+        break;
+      case OPT_COMMAND_TIMEOUT:
+        if (!isdigit(optarg[0])) {
+          LOGF << "Argument '--command-timeout' should be number";
+          exit(1);
+        }
+        opts.command_timeout = std::stol(optarg);
+        LOGV << "Command timeout set: " << opts.command_timeout << " sec(s)";
+        break;
+      case OPT_AUR_TIMEOUT:
+        if (!isdigit(optarg[0])) {
+          LOGF << "Argument '--aur-timeout' should be number";
+          exit(1);
+        }
+        opts.aur_timeout = std::stol(optarg);
+        LOGV << "AUR timeout set: " << opts.aur_timeout << " sec(s)";
+        break;
+      case OPT_NATIVE:
+        opts.native = true;
+        LOGV << "Reading pacman databases natively";
+        break;
+      case OPT_DBPATH:
+        opts.dbpath = optarg;
+        LOGV << "Database path set: '" << opts.dbpath << "'";
+        break;
+      case OPT_PACMAN_CONF:
+        opts.pacman_conf = optarg;
+        LOGV << "pacman.conf set: '" << opts.pacman_conf << "'";
+        break;
+      case OPT_AUR_URL:
+        opts.aur_url = optarg;
+        LOGV << "AUR URL set: '" << opts.aur_url << "'";
+        break;
+      case OPT_AUR_CACHE_TTL:
+        if (!isdigit(optarg[0])) {
+          LOGF << "Argument '--aur-cache-ttl' should be number";
+          exit(1);
+        }
+        opts.aur_cache_ttl = std::stol(optarg) * 60;
+        LOGV << "AUR cache TTL set: " << opts.aur_cache_ttl / 60 << " min(s)";
+        break;
+      case OPT_SUMMARY:
+        opts.summary = true;
+        LOGV << "Summarizing updates";
+        break;
+      case OPT_JOURNAL:
+        /* Already set up before parsing. */
+        LOGV << "Logging to the journal";
+        break;
+      case OPT_LOG_FILE:
+        opts.log_file = optarg;
+        LOGV << "Log file set: '" << opts.log_file << "'";
+        break;
+      case OPT_METRICS_FILE:
+        opts.metrics_file = optarg;
+        LOGV << "Metrics file set: '" << opts.metrics_file << "'";
+        break;
+      case OPT_WATCH:
+        opts.watch = true;
+        opts.will_loop = TRUE;
+        LOGV << "Watching pacman databases for changes";
         break;
       case 'h':
       case '?':
@@ -242,123 +1070,66 @@ int main(int argc, char **argv) {
     }
   }
 
-  long offset = 0;
-  NotifyNotification *my_notify = nullptr;
-  const char *name = "New Updates";
-  const char *category = "update";
-  GError *error = nullptr;
-  do {
-    LOGD << "Executing command '" << command << "' for updates";
-    auto checkUpdatesCmd = std::make_unique<CliWrapper>(command);
-    const std::string &checkUpdateOut = checkUpdatesCmd->execute();
-    std::string aurHelperOut;
-    if (aur) {
-      LOGD << "Executing command '" << aurCommand << "' for AUR updates";
-      auto aurHelperCmd = std::make_unique<CliWrapper>(aurCommand);
-      aurHelperOut = aurHelperCmd->execute();
-    }
-    if (!checkUpdateOut.empty() || (!aurHelperOut.empty())) {
-      std::string finalOut = "There are updates for:\n";
-      if (aurHelperOut.empty()) {
-        finalOut = finalOut + checkUpdateOut;
-      } else if (checkUpdateOut.empty()) {
-        finalOut = finalOut + AUR_HEADER + aurHelperOut;
-      } else {
-        finalOut = finalOut + checkUpdateOut + AUR_HEADER + aurHelperOut;
-      }
-      auto outputLines = split(finalOut, '\n');
-      int lines = 0;
-      std::stringstream ss;
-      for (auto &outputLine : outputLines) {
-        ss << outputLine << '\n';
-        lines++;
-        if (lines >= max_number_out) {
-          break;
-        }
-      }
-      if (!notify_is_initted()) {
-        notify_init(name);
-      }
-      bool persist = TRUE;
-      gboolean success;
-      do {
-        if (!my_notify) {
-          my_notify = notify_notification_new(
-              "New updates for Arch Linux available!", ss.str().c_str(), icon);
-        } else {
-          notify_notification_update(my_notify,
-                                     "New updates for Arch Linux available!",
-                                     ss.str().c_str(), icon);
-        }
-        notify_notification_set_timeout(my_notify, timeout);
-        notify_notification_set_category(my_notify, category);
-        notify_notification_set_urgency(my_notify, urgency);
-        success = notify_notification_show(my_notify, &error);
-        if (success)
-          LOGD << "Notification shown successfully";
-        else {
-          if (persist) {
-            LOGW << "Notification failed, reason:\n\t[" << error->code << "] "
-                 << error->message << "\n";
-          } else {
-            LOGE << "Notification failed, reason:\n\t[" << error->code << "] "
-                 << error->message << "\n";
-          }
-          g_error_free(error);
-          error = nullptr;
-          if (persist) {
-            LOGW << "It could have been caused by an environment restart, "
-                    "trying to work around it by re-init libnotify";
-            my_notify = nullptr;
-            notify_uninit();
-            notify_init(name);
-            persist = FALSE;
-          }
-        }
-      } while (!my_notify);
-      if (error) {
-        g_error_free(error);
-        error = nullptr;
-      }
-      if (manual_timeout && success && will_loop) {
-        LOGD << "Will close notification in " << manual_timeout / 60
-             << " minutes (this time will be reduced from the loop-time)";
-        sleep(static_cast<unsigned int>(manual_timeout));
-        offset = manual_timeout;
-        if (notify_notification_close(my_notify, &error))
-          LOGD << "Notification closed";
-        else {
-          LOGW << "Failed to close, reason:\n\t[" << error->code << "] "
-               << error->message;
-        }
-        if (error) {
-          g_error_free(error);
-          error = nullptr;
-        }
-      }
+  if (opts.log_file) {
+    /* Buffered, so a verbose daemon doesn't make a write per record;
+     * warnings and worse are written at once. */
+    const char *dot = strrchr(opts.log_file, '.');
+    if (dot && strcmp(dot, ".bin") == 0) {
+      static plog::BinaryFileAppender fileAppender(opts.log_file, 1024 * 1024,
+                                                   3);
+      plog::get()->addAppender(&fileAppender);
     } else {
-      LOGI << "No updates found";
-      if (my_notify) {
-        LOGD << "Previous notification found. Closing it in case it was "
-                "still opened";
-        if (notify_notification_close(my_notify, &error))
-          LOGD << "Notification closed";
-        else {
-          LOGW << "Failed to close, reason:\n\t[" << error->code << "] "
-               << error->message;
-        }
-        if (error) {
-          g_error_free(error);
-          error = nullptr;
-        }
-      }
+      static plog::RollingFileAppender<plog::TxtFormatter> fileAppender(
+          opts.log_file, 1024 * 1024, 3);
+      fileAppender.setBuffering(64 * 1024, 1000, plog::warning);
+      plog::get()->addAppender(&fileAppender);
     }
+  }
 
-    if (will_loop) {
-      LOGD << "Next run will be in " << (loop_time - offset) / 60 << " minutes";
-      sleep(static_cast<unsigned int>(loop_time - offset));
-      offset = 0;
+  if (opts.watch) {
+    try {
+      app.watcher = std::make_unique<PacmanWatcher>(
+          load_pacman_conf(opts.pacman_conf, opts.dbpath));
+    } catch (const std::exception &e) {
+      LOGW << "Can't watch pacman databases, checking every "
+           << opts.loop_time / 60 << " minutes only: " << e.what();
     }
-  } while (will_loop);
+  }
+
+  const std::string stateDir = xdgStateDir();
+  app.statePath =
+      stateDir.empty() ? std::string() : stateDir + "/" + CheckState::FILE_NAME;
+  app.state = CheckState::load(app.statePath);
+  app.notifier = std::make_unique<Notifier>("New Updates");
+  app.notifier->setClosedHandler(
+      [&app](uint32_t id) { on_notification_closed(app, id); });
+  app.notifier->setRestartHandler([&app]() { on_notifier_restart(app); });
+
+  if (!opts.will_loop) {
+    app.allocations = AllocCounter::count();
+    CheckJob job(opts);
+    run_job(job);
+    finish_check(app, job);
+    app.notifier->flush();
+    return 0;
+  }
+
+  /* Checks, the --ftimeout close, pacman database changes and signals are
+   * independent sources, so none of them waits for another. */
+  app.loop = g_main_loop_new(nullptr, FALSE);
+  g_unix_signal_add(SIGINT, on_quit_signal, &app);
+  g_unix_signal_add(SIGTERM, on_quit_signal, &app);
+  g_unix_signal_add(SIGHUP, on_check_signal, &app);
+  if (app.watcher) {
+    g_unix_fd_add(app.watcher->fd(), G_IO_IN, on_pacman_event, &app);
+  }
+  start_check(app);
+  g_main_loop_run(app.loop);
+  /* The worker uses app's job and options, and may still log. */
+  while (app.checking) {
+    g_main_context_iteration(nullptr, TRUE);
+  }
+  LOGD << "Shutting down";
+  g_main_loop_unref(app.loop);
   return 0;
 }
@@ -0,0 +1,304 @@
+#pragma once
+#include <plog/Appenders/IAppender.h>
+#include <plog/Util.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace plog
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Hands records to another appender on a thread of its own, so the
+    // logging thread only copies the record into a bounded queue. Any number
+    // of threads may log; the queue is lock-free for them (Vyukov's bounded
+    // queue, one sequence number per slot). When it is full, records are
+    // dropped and counted, or the caller waits for room. The destructor
+    // writes out everything that was queued.
+
+    class AsyncAppender : public IAppender, util::NonCopyable
+    {
+    public:
+        enum Overflow
+        {
+            kDrop,
+            kBlock
+        };
+
+        // capacity is rounded up to a power of two.
+        AsyncAppender(IAppender* appender, size_t capacity = 1024, Overflow overflow = kDrop)
+            : m_appender(appender)
+            , m_slots(roundUp(capacity))
+            , m_mask(m_slots.size() - 1)
+            , m_overflow(overflow)
+            , m_enqueuePos(0)
+            , m_dequeuePos(0)
+            , m_dropped(0)
+            , m_reported(0)
+            , m_sleeping(false)
+            , m_blocked(0)
+            , m_stop(false)
+        {
+            for (size_t i = 0; i < m_slots.size(); ++i)
+            {
+                m_slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+
+            m_thread = std::thread(&AsyncAppender::run, this);
+        }
+
+        virtual ~AsyncAppender()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+
+            m_wake.notify_one();
+            m_thread.join();
+        }
+
+        virtual void write(const Record& record)
+        {
+            Slot* slot;
+            size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+
+            for (;;)
+            {
+                slot = &m_slots[pos & m_mask];
+                const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+                const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence - pos);
+
+                if (diff == 0)
+                {
+                    if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    // Full: the slot still holds a record from a lap ago.
+                    if (m_overflow == kDrop)
+                    {
+                        m_dropped.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+
+                    waitForRoom(pos);
+                    pos = m_enqueuePos.load(std::memory_order_relaxed);
+                }
+                else
+                {
+                    pos = m_enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            slot->severity = record.getSeverity();
+            slot->func = record.getFunc();
+            slot->line = record.getLine();
+            slot->file = record.getFile();
+            slot->object = record.getObject();
+            slot->time = record.getTime();
+            slot->tid = record.getTid();
+            slot->message = record.getMessage();
+            slot->fields = record.getFields();
+            // Sequentially consistent, like the other side in run(): either
+            // the consumer sees this record before going to sleep or we see
+            // it asleep.
+            slot->sequence.store(pos + 1);
+            if (m_sleeping.load())
+            {
+                wake();
+            }
+        }
+
+        // Waits until everything logged so far has been written.
+        void flush()
+        {
+            const size_t target = m_enqueuePos.load(std::memory_order_acquire);
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.notify_one();
+            m_drained.wait(lock, [this, target]() { return m_dequeuePos.load(std::memory_order_acquire) >= target; });
+        }
+
+        // Records lost to a full queue so far.
+        size_t getDropped() const
+        {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct Slot
+        {
+            std::atomic<size_t>     sequence;
+            Severity                severity;
+            std::string             func;
+            size_t                  line;
+            const char*             file;
+            const void*             object;
+            util::Time              time;
+            unsigned int            tid;
+            util::nstring           message;
+            std::vector<Field>      fields;
+        };
+
+        static size_t roundUp(size_t capacity)
+        {
+            size_t size = 2;
+            while (size < capacity)
+            {
+                size *= 2;
+            }
+
+            return size;
+        }
+
+        void wake()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_wake.notify_one();
+        }
+
+        // Sleeps until the consumer frees the slot at pos, or another writer
+        // has taken it. Same handshake as run(): we say we are waiting, then
+        // look at the slot, both sequentially consistent and under m_mutex;
+        // drain() frees slots the other way round and notifies under
+        // m_mutex. So either we see the room or drain() sees us.
+        void waitForRoom(size_t pos)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_blocked.fetch_add(1);
+            m_room.wait(lock, [this, pos]()
+            {
+                const size_t sequence = m_slots[pos & m_mask].sequence.load();
+                return static_cast<std::ptrdiff_t>(sequence - pos) >= 0 || m_enqueuePos.load(std::memory_order_relaxed) != pos;
+            });
+            m_blocked.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        // Whether the next record to write is in. Sequentially consistent,
+        // see run().
+        bool queued() const
+        {
+            const size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+            return m_slots[pos & m_mask].sequence.load() == pos + 1;
+        }
+
+        // Writes out queued records until the queue is empty. Returns false
+        // if there was nothing to write.
+        bool drain()
+        {
+            bool wrote = false;
+            size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+
+            for (;;)
+            {
+                Slot& slot = m_slots[pos & m_mask];
+                if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+                {
+                    break;
+                }
+
+                // The slot's func is already processed; the record's own
+                // getFunc() would find no '(' in it and keep it as is.
+                detail::StoredRecord record(slot.severity, slot.func.c_str(), slot.line, slot.file, slot.object, slot.time, slot.tid, slot.message, slot.fields);
+                m_appender->write(record);
+
+                // Sequentially consistent, see waitForRoom().
+                slot.sequence.store(pos + m_slots.size());
+                m_dequeuePos.store(++pos, std::memory_order_release);
+                wrote = true;
+
+                if (m_blocked.load())
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_room.notify_all();
+                }
+            }
+
+            reportDropped();
+            return wrote;
+        }
+
+        // Says how many records went missing, in the stream they went
+        // missing from.
+        void reportDropped()
+        {
+            const size_t dropped = m_dropped.load(std::memory_order_relaxed);
+            if (dropped == m_reported)
+            {
+                return;
+            }
+
+            util::nostringstream ss;
+            ss << dropped - m_reported << PLOG_NSTR(" log records dropped, the queue was full");
+            m_reported = dropped;
+
+            util::Time now;
+            util::ftime(&now);
+            const util::nstring message = ss.str();
+            const std::vector<Field> fields;
+            detail::StoredRecord record(warning, "AsyncAppender", 0, __FILE__, NULL, now, util::gettid(), message, fields);
+            m_appender->write(record);
+        }
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            for (;;)
+            {
+                lock.unlock();
+                const bool wrote = drain();
+                lock.lock();
+
+                if (wrote)
+                {
+                    m_drained.notify_all();
+                    continue;
+                }
+
+                if (m_stop)
+                {
+                    break;
+                }
+
+                // A writer that sees m_sleeping wakes us under m_mutex, which
+                // we hold until wait() lets go of it; one that doesn't, we
+                // see in queued(). So no timeout is needed.
+                m_sleeping.store(true);
+
+                if (!queued())
+                {
+                    m_drained.notify_all();
+                    m_wake.wait(lock, [this]() { return m_stop || queued(); });
+                }
+
+                m_sleeping.store(false, std::memory_order_relaxed);
+            }
+
+            m_drained.notify_all();
+        }
+
+    private:
+        IAppender* const            m_appender;
+        std::vector<Slot>           m_slots;
+        const size_t                m_mask;
+        const Overflow              m_overflow;
+        std::atomic<size_t>         m_enqueuePos;
+        std::atomic<size_t>         m_dequeuePos;
+        std::atomic<size_t>         m_dropped;
+        size_t                      m_reported;
+        std::atomic<bool>           m_sleeping;
+        std::atomic<unsigned>       m_blocked;
+        bool                        m_stop;
+        std::mutex                  m_mutex;
+        std::condition_variable     m_wake;
+        std::condition_variable     m_drained;
+        std::condition_variable     m_room;
+        std::thread                 m_thread;
+    };
+}
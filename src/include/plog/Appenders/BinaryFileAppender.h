@@ -0,0 +1,23 @@
+#pragma once
+#include <plog/Appenders/RollingFileAppender.h>
+#include <plog/Converters/BinaryConverter.h>
+#include <plog/Formatters/BinaryFormatter.h>
+
+namespace plog
+{
+    //////////////////////////////////////////////////////////////////////////
+    // A RollingFileAppender writing BinaryFormatter records, buffered from
+    // the start: records go out once bufferSize bytes are waiting, after a
+    // second, or at once for warnings and worse. setBuffering() changes
+    // that. Read the files back with BinaryReader.
+
+    class BinaryFileAppender : public RollingFileAppender<BinaryFormatter, BinaryConverter>
+    {
+    public:
+        BinaryFileAppender(const util::nchar* fileName, size_t maxFileSize = 0, int maxFiles = 0, size_t bufferSize = 64 * 1024)
+            : RollingFileAppender<BinaryFormatter, BinaryConverter>(fileName, maxFileSize, maxFiles)
+        {
+            setBuffering(bufferSize);
+        }
+    };
+}
@@ -0,0 +1,216 @@
+#pragma once
+#include <plog/Appenders/IAppender.h>
+#include <plog/Util.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+namespace plog
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Sends records to systemd-journald over its native socket, one datagram
+    // per record, as fields rather than a formatted line: MESSAGE, PRIORITY,
+    // CODE_FILE, CODE_LINE, CODE_FUNC, TID, SYSLOG_IDENTIFIER when one is
+    // given, and the record's own fields (see plog::field). journald adds
+    // the time, pid and unit itself. Records that can't be sent, e.g. when
+    // there is no journal, go to the fallback appender if there is one.
+
+    class JournaldAppender : public IAppender, util::NonCopyable
+    {
+    public:
+        JournaldAppender(const char* identifier = NULL, IAppender* fallback = NULL)
+            : m_identifier(identifier), m_fallback(fallback)
+        {
+            m_fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+            memset(&m_address, 0, sizeof(m_address));
+            m_address.sun_family = AF_UNIX;
+            strncpy(m_address.sun_path, "/run/systemd/journal/socket", sizeof(m_address.sun_path) - 1);
+        }
+
+        virtual ~JournaldAppender()
+        {
+            if (m_fd >= 0)
+            {
+                ::close(m_fd);
+            }
+        }
+
+        virtual void write(const Record& record)
+        {
+            bool sent;
+
+            {
+                util::MutexLock lock(m_mutex);
+
+                m_buffer.clear();
+                appendField("MESSAGE", record.getMessage());
+                appendField("PRIORITY", toPriority(record.getSeverity()));
+                appendField("CODE_LINE", record.getLine());
+                appendField("CODE_FUNC", record.getFunc());
+                appendField("TID", record.getTid());
+
+                // Empty unless PLOG_CAPTURE_FILE is defined.
+                if (*record.getFile())
+                {
+                    appendField("CODE_FILE", record.getFile());
+                }
+
+                if (m_identifier)
+                {
+                    appendField("SYSLOG_IDENTIFIER", m_identifier);
+                }
+
+                const std::vector<Field>& fields = record.getFields();
+                for (std::vector<Field>::const_iterator it = fields.begin(); it != fields.end(); ++it)
+                {
+                    appendField(it->key, it->value.data(), it->value.size());
+                }
+
+                sent = send();
+            }
+
+            if (!sent && m_fallback)
+            {
+                m_fallback->write(record);
+            }
+        }
+
+    private:
+        static unsigned long toPriority(Severity severity)
+        {
+            switch (severity)
+            {
+            case fatal:
+                return 2; // LOG_CRIT
+            case error:
+                return 3; // LOG_ERR
+            case warning:
+                return 4; // LOG_WARNING
+            case info:
+                return 6; // LOG_INFO
+            default:
+                return 7; // LOG_DEBUG
+            }
+        }
+
+        void appendField(const char* key, const char* value)
+        {
+            appendField(key, value, strlen(value));
+        }
+
+        void appendField(const char* key, unsigned long value)
+        {
+            m_buffer.append(key);
+            m_buffer.push_back('=');
+            util::appendNumber(m_buffer, value);
+            m_buffer.push_back('\n');
+        }
+
+        // KEY=value, or for values with a newline in them, KEY followed by
+        // the value's length as 64-bit little endian and the value itself.
+        void appendField(const char* key, const char* value, size_t size)
+        {
+            m_buffer.append(key);
+
+            if (!memchr(value, '\n', size))
+            {
+                m_buffer.push_back('=');
+            }
+            else
+            {
+                m_buffer.push_back('\n');
+
+                uint64_t length = size;
+                for (int i = 0; i < 8; ++i, length >>= 8)
+                {
+                    m_buffer.push_back(static_cast<char>(length & 0xff));
+                }
+            }
+
+            m_buffer.append(value, size);
+            m_buffer.push_back('\n');
+        }
+
+        bool send()
+        {
+            if (m_fd < 0)
+            {
+                return false;
+            }
+
+            iovec iov;
+            iov.iov_base = const_cast<char*>(m_buffer.data());
+            iov.iov_len = m_buffer.size();
+
+            msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_name = &m_address;
+            msg.msg_namelen = sizeof(m_address);
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+
+            if (::sendmsg(m_fd, &msg, MSG_NOSIGNAL) >= 0)
+            {
+                return true;
+            }
+
+            return errno == EMSGSIZE && sendLarge(msg);
+        }
+
+        // Too big for a datagram: journald also takes the record as a sealed
+        // memory file passed along with an empty message.
+        bool sendLarge(msghdr& msg)
+        {
+#ifdef MFD_ALLOW_SEALING
+            const int fd = ::memfd_create("plog-journal", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+            if (fd < 0)
+            {
+                return false;
+            }
+
+            bool sent = false;
+            if (::write(fd, m_buffer.data(), m_buffer.size()) == static_cast<ssize_t>(m_buffer.size())
+                && ::fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == 0)
+            {
+                union
+                {
+                    cmsghdr header;
+                    char    data[CMSG_SPACE(sizeof(int))];
+                } control;
+                memset(&control, 0, sizeof(control));
+
+                msg.msg_iov = NULL;
+                msg.msg_iovlen = 0;
+                msg.msg_control = &control;
+                msg.msg_controllen = sizeof(control);
+
+                cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+                cmsg->cmsg_level = SOL_SOCKET;
+                cmsg->cmsg_type = SCM_RIGHTS;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+                memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+                sent = ::sendmsg(m_fd, &msg, MSG_NOSIGNAL) >= 0;
+            }
+
+            ::close(fd);
+            return sent;
+#else
+            (void)msg;
+            return false;
+#endif
+        }
+
+    private:
+        const char* const   m_identifier;
+        IAppender* const    m_fallback;
+        int                 m_fd;
+        sockaddr_un         m_address;
+        std::string         m_buffer;
+        util::Mutex         m_mutex;
+    };
+}
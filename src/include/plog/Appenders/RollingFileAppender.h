@@ -3,6 +3,10 @@
 #include <plog/Converters/UTF8Converter.h>
 #include <plog/Util.h>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace plog
 {
@@ -15,6 +19,12 @@ namespace plog
             , m_maxFileSize((std::max)(static_cast<off_t>(maxFileSize), static_cast<off_t>(1000))) // set a lower limit for the maxFileSize
             , m_lastFileNumber((std::max)(maxFiles - 1, 0))
             , m_firstWrite(true)
+            , m_bufferSize()
+            , m_flushInterval()
+            , m_flushSeverity(none)
+            , m_sync()
+            , m_stopFlusher()
+            , m_flushPending()
         {
             util::splitFileName(fileName, m_fileNameNoExt, m_fileExt);
         }
@@ -25,11 +35,60 @@ namespace plog
             , m_maxFileSize((std::max)(static_cast<off_t>(maxFileSize), static_cast<off_t>(1000))) // set a lower limit for the maxFileSize
             , m_lastFileNumber((std::max)(maxFiles - 1, 0))
             , m_firstWrite(true)
+            , m_bufferSize()
+            , m_flushInterval()
+            , m_flushSeverity(none)
+            , m_sync()
+            , m_stopFlusher()
+            , m_flushPending()
         {
             util::splitFileName(util::toWide(fileName).c_str(), m_fileNameNoExt, m_fileExt);
         }
 #endif
 
+        virtual ~RollingFileAppender()
+        {
+            stopFlusher();
+
+            util::MutexLock lock(m_mutex);
+            flushBuffer();
+        }
+
+        // Buffered mode: formatted records collect in memory and go to the
+        // file in one write once bufferSize bytes are waiting, the oldest
+        // has waited flushInterval milliseconds (0 for no limit), or a
+        // record at flushSeverity or worse comes in. With sync, every such
+        // write is also synced to disk. Buffered bytes count towards
+        // maxFileSize, so files roll where they would unbuffered. A
+        // bufferSize of 0, the default, writes each record as it comes.
+        void setBuffering(size_t bufferSize, unsigned int flushInterval = 1000, Severity flushSeverity = warning, bool sync = false)
+        {
+            stopFlusher();
+
+            {
+                util::MutexLock lock(m_mutex);
+                flushBuffer();
+
+                m_bufferSize = bufferSize;
+                m_flushInterval = flushInterval;
+                m_flushSeverity = flushSeverity;
+                m_sync = sync;
+                m_buffer.reserve(bufferSize);
+            }
+
+            if (bufferSize > 0 && flushInterval > 0)
+            {
+                m_flusher = std::thread(&RollingFileAppender::runFlusher, this);
+            }
+        }
+
+        // Writes out whatever is buffered.
+        void flush()
+        {
+            util::MutexLock lock(m_mutex);
+            flushBuffer();
+        }
+
         virtual void write(const Record& record)
         {
             util::MutexLock lock(m_mutex);
@@ -39,22 +98,135 @@ namespace plog
                 openLogFile();
                 m_firstWrite = false;
             }
-            else if (m_lastFileNumber > 0 && m_fileSize > m_maxFileSize && -1 != m_fileSize)
+            else if (m_lastFileNumber > 0 && m_fileSize + static_cast<off_t>(m_buffer.size()) > m_maxFileSize && -1 != m_fileSize)
             {
                 rollLogFiles();
             }
 
-            int bytesWritten = m_file.write(Converter::convert(Formatter::format(record)));
+            writeData(Converter::convert(m_formatter.format(record)));
+
+            if (!m_buffer.empty() && (m_buffer.size() >= m_bufferSize || record.getSeverity() <= m_flushSeverity))
+            {
+                flushBuffer();
+            }
+        }
+
+    private:
+        // Into the buffer in buffered mode, straight to the file otherwise.
+        void writeData(const std::string& data)
+        {
+            if (!m_bufferSize)
+            {
+                int bytesWritten = m_file.write(data);
+
+                if (bytesWritten > 0)
+                {
+                    m_fileSize += bytesWritten;
+                }
+
+                return;
+            }
+
+            if (m_buffer.empty())
+            {
+                m_bufferSince = std::chrono::steady_clock::now();
+
+                // The flusher sleeps until a buffer starts filling up.
+                if (m_flushInterval > 0)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(m_flusherMutex);
+                        m_flushPending = true;
+                        m_flushDue = m_bufferSince + std::chrono::milliseconds(m_flushInterval);
+                    }
+
+                    m_flusherWake.notify_one();
+                }
+            }
+
+            m_buffer.append(data);
+        }
+
+        void flushBuffer()
+        {
+            if (m_buffer.empty())
+            {
+                return;
+            }
+
+            int bytesWritten = m_file.write(m_buffer);
 
             if (bytesWritten > 0)
             {
                 m_fileSize += bytesWritten;
             }
+
+            if (m_sync)
+            {
+                m_file.sync();
+            }
+
+            m_buffer.clear();
+        }
+
+        // Flushes records that have waited flushInterval, until stopped.
+        // Writers take m_mutex before m_flusherMutex, so this never holds
+        // the latter while it takes the former.
+        void runFlusher()
+        {
+            const std::chrono::milliseconds interval(m_flushInterval);
+
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(m_flusherMutex);
+
+                    // Idle, without a timeout, until a writer starts filling
+                    // the empty buffer, then until its oldest record is due.
+                    m_flusherWake.wait(lock, [this]() { return m_stopFlusher || m_flushPending; });
+                    if (m_stopFlusher)
+                    {
+                        return;
+                    }
+
+                    m_flushPending = false;
+                    if (m_flusherWake.wait_until(lock, m_flushDue, [this]() { return m_stopFlusher; }))
+                    {
+                        return;
+                    }
+                }
+
+                // Writers may have flushed and started a newer buffer since,
+                // which set m_flushPending again.
+                util::MutexLock bufferLock(m_mutex);
+                if (!m_buffer.empty() && std::chrono::steady_clock::now() - m_bufferSince >= interval)
+                {
+                    flushBuffer();
+                }
+            }
+        }
+
+        void stopFlusher()
+        {
+            if (!m_flusher.joinable())
+            {
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_flusherMutex);
+                m_stopFlusher = true;
+            }
+
+            m_flusherWake.notify_one();
+            m_flusher.join();
+            m_stopFlusher = false;
+            m_flushPending = false;
         }
 
-    private:
         void rollLogFiles()
         {
+            flushBuffer();
             m_file.close();
 
             util::nstring lastFileName = buildFileName(m_lastFileNumber);
@@ -78,12 +250,7 @@ namespace plog
 
             if (0 == m_fileSize)
             {
-                int bytesWritten = m_file.write(Converter::header(Formatter::header()));
-
-                if (bytesWritten > 0)
-                {
-                    m_fileSize += bytesWritten;
-                }
+                writeData(Converter::header(m_formatter.header()));
             }
         }
 
@@ -107,6 +274,7 @@ namespace plog
 
     private:
         util::Mutex     m_mutex;
+        Formatter       m_formatter;
         util::File      m_file;
         off_t           m_fileSize;
         const off_t     m_maxFileSize;
@@ -114,5 +282,17 @@ namespace plog
         util::nstring   m_fileExt;
         util::nstring   m_fileNameNoExt;
         bool            m_firstWrite;
+        size_t          m_bufferSize;
+        unsigned int    m_flushInterval;
+        Severity        m_flushSeverity;
+        bool            m_sync;
+        std::string     m_buffer;
+        std::chrono::steady_clock::time_point m_bufferSince;
+        std::thread     m_flusher;
+        std::mutex      m_flusherMutex;
+        std::condition_variable m_flusherWake;
+        bool            m_stopFlusher;
+        bool            m_flushPending;
+        std::chrono::steady_clock::time_point m_flushDue;
     };
 }
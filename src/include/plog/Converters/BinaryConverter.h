@@ -0,0 +1,21 @@
+#pragma once
+#include <plog/Util.h>
+
+namespace plog
+{
+    // Writes the formatter's bytes as they are: no BOM, no re-encoding.
+    // For BinaryFormatter, whose output is not text.
+    class BinaryConverter
+    {
+    public:
+        static const std::string& header(const std::string& str)
+        {
+            return str;
+        }
+
+        static const std::string& convert(const std::string& str)
+        {
+            return str;
+        }
+    };
+}
@@ -0,0 +1,276 @@
+#pragma once
+#include <plog/Record.h>
+#include <plog/Util.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace plog
+{
+    //////////////////////////////////////////////////////////////////////////
+    // Compact binary log format. A file starts with an 8 byte magic, then
+    // holds entries, all integers little endian:
+    //
+    //   site:   u8 1, u32 id, u32 line, u16 length + function name,
+    //           u16 length + file name
+    //   record: u8 2, u32 site id, u8 severity, u32 tid, i64 seconds,
+    //           u32 nanoseconds, u64 object, u32 length + message
+    //
+    // A call site (function, line and file) is written once per file, the
+    // first time it logs; records refer to it by id. A process that appends
+    // to an existing file starts its ids over and writes its sites again,
+    // so a later site entry replaces an earlier one with the same id.
+    // Record fields are not stored. Needs a narrow util::nstring, which
+    // rules out Windows.
+
+    class BinaryFormatter
+    {
+    public:
+        enum Entry
+        {
+            kSite = 1,
+            kRecord = 2
+        };
+
+        static const char* magic()
+        {
+            return "PLOGBIN\x01";
+        }
+
+        static const size_t kMagicSize = 8;
+
+        BinaryFormatter() : m_nextId()
+        {
+        }
+
+        // Called for each new file, which needs its sites again.
+        util::nstring header()
+        {
+            m_sites.clear();
+            m_nextId = 0;
+
+            return util::nstring(magic(), kMagicSize);
+        }
+
+        util::nstring format(const Record& record)
+        {
+            util::nstring str;
+            const char* func = record.getFunc();
+            const char* message = record.getMessage();
+            const size_t messageSize = strlen(message);
+
+            str.reserve(64 + messageSize);
+            const uint32_t site = intern(str, func, record.getLine(), record.getFile());
+
+            const util::Time& time = record.getTime();
+            str.push_back(static_cast<char>(kRecord));
+            putNumber(str, site, 4);
+            str.push_back(static_cast<char>(record.getSeverity()));
+            putNumber(str, record.getTid(), 4);
+            putNumber(str, static_cast<uint64_t>(time.time), 8);
+            putNumber(str, util::nanoseconds(time), 4);
+            putNumber(str, reinterpret_cast<uintptr_t>(record.getObject()), 8);
+            putNumber(str, messageSize, 4);
+            str.append(message, messageSize);
+
+            return str;
+        }
+
+        static void putNumber(util::nstring& str, uint64_t value, int bytes)
+        {
+            for (int i = 0; i < bytes; ++i, value >>= 8)
+            {
+                str.push_back(static_cast<char>(value & 0xff));
+            }
+        }
+
+    private:
+        struct Site
+        {
+            std::string func;
+            std::string file;
+            uint32_t    id;
+        };
+
+        // The id of the call site, writing its entry first if it is new.
+        // Looked up by line, then compared by content: the func pointer
+        // differs between a Record and one rebuilt by AsyncAppender.
+        uint32_t intern(util::nstring& str, const char* func, size_t line, const char* file)
+        {
+            typedef std::unordered_multimap<size_t, Site>::iterator Iterator;
+            std::pair<Iterator, Iterator> range = m_sites.equal_range(line);
+
+            for (Iterator it = range.first; it != range.second; ++it)
+            {
+                if (it->second.func == func && it->second.file == file)
+                {
+                    return it->second.id;
+                }
+            }
+
+            Site site;
+            site.func = func;
+            site.file = file;
+            site.id = m_nextId++;
+
+            str.push_back(static_cast<char>(kSite));
+            putNumber(str, site.id, 4);
+            putNumber(str, line, 4);
+            putString(str, site.func);
+            putString(str, site.file);
+
+            const uint32_t id = site.id;
+            m_sites.insert(std::make_pair(line, site));
+            return id;
+        }
+
+        static void putString(util::nstring& str, const std::string& value)
+        {
+            const size_t size = value.size() < 0xffff ? value.size() : 0xffff;
+            putNumber(str, size, 2);
+            str.append(value, 0, size);
+        }
+
+    private:
+        std::unordered_multimap<size_t, Site> m_sites;
+        uint32_t m_nextId;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // Reads back what BinaryFormatter wrote, e.g. to format it as text.
+
+    class BinaryReader
+    {
+    public:
+        // data holds a whole file.
+        BinaryReader(const char* data, size_t size) : m_data(data), m_size(size), m_pos()
+        {
+        }
+
+        // Calls handler(const Record&) for every record. Returns false if
+        // the data is not a binary log or stops in the middle of an entry,
+        // as the last write before a crash can.
+        template<class Handler>
+        bool read(Handler handler)
+        {
+            if (m_size < BinaryFormatter::kMagicSize || memcmp(m_data, BinaryFormatter::magic(), BinaryFormatter::kMagicSize) != 0)
+            {
+                return false;
+            }
+
+            m_pos = BinaryFormatter::kMagicSize;
+            util::nstring message;
+            const std::vector<Field> fields;
+
+            while (m_pos < m_size)
+            {
+                const unsigned char entry = static_cast<unsigned char>(m_data[m_pos++]);
+
+                if (entry == BinaryFormatter::kSite)
+                {
+                    uint64_t id;
+                    uint64_t line;
+                    SiteInfo site;
+
+                    // Ids are handed out in order, so a new one is the next.
+                    if (!getNumber(id, 4) || !getNumber(line, 4) || !getString(site.func) || !getString(site.file)
+                        || id > m_sites.size())
+                    {
+                        return false;
+                    }
+
+                    site.line = static_cast<size_t>(line);
+                    if (id == m_sites.size())
+                    {
+                        m_sites.push_back(site);
+                    }
+                    else
+                    {
+                        m_sites[static_cast<size_t>(id)] = site;
+                    }
+                }
+                else if (entry == BinaryFormatter::kRecord)
+                {
+                    uint64_t id;
+                    uint64_t severity = 0;
+                    uint64_t tid;
+                    uint64_t seconds;
+                    uint64_t nanoseconds;
+                    uint64_t object;
+                    uint64_t size;
+
+                    if (!getNumber(id, 4) || !getNumber(severity, 1) || !getNumber(tid, 4) || !getNumber(seconds, 8)
+                        || !getNumber(nanoseconds, 4) || !getNumber(object, 8) || !getNumber(size, 4)
+                        || id >= m_sites.size() || size > m_size - m_pos)
+                    {
+                        return false;
+                    }
+
+                    message.assign(m_data + m_pos, static_cast<size_t>(size));
+                    m_pos += static_cast<size_t>(size);
+
+                    util::Time time;
+                    time.time = static_cast<time_t>(seconds);
+                    time.millitm = static_cast<unsigned short>(nanoseconds / 1000000);
+#ifndef _WIN32
+                    time.nanotm = static_cast<unsigned int>(nanoseconds);
+#endif
+
+                    const SiteInfo& site = m_sites[static_cast<size_t>(id)];
+                    detail::StoredRecord record(static_cast<Severity>(severity), site.func.c_str(), site.line, site.file.c_str(),
+                        reinterpret_cast<const void*>(static_cast<uintptr_t>(object)), time, static_cast<unsigned int>(tid), message, fields);
+                    handler(static_cast<const Record&>(record));
+                }
+                else
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+    private:
+        struct SiteInfo
+        {
+            std::string func;
+            std::string file;
+            size_t      line;
+        };
+
+        bool getNumber(uint64_t& value, int bytes)
+        {
+            if (m_size - m_pos < static_cast<size_t>(bytes))
+            {
+                return false;
+            }
+
+            value = 0;
+            for (int i = 0; i < bytes; ++i)
+            {
+                value |= static_cast<uint64_t>(static_cast<unsigned char>(m_data[m_pos++])) << (8 * i);
+            }
+
+            return true;
+        }
+
+        bool getString(std::string& value)
+        {
+            uint64_t size;
+            if (!getNumber(size, 2) || size > m_size - m_pos)
+            {
+                return false;
+            }
+
+            value.assign(m_data + m_pos, static_cast<size_t>(size));
+            m_pos += static_cast<size_t>(size);
+            return true;
+        }
+
+    private:
+        const char* const       m_data;
+        const size_t            m_size;
+        size_t                  m_pos;
+        std::vector<SiteInfo>   m_sites;
+    };
+}
@@ -1,7 +1,6 @@
 #pragma once
 #include <plog/Record.h>
 #include <plog/Util.h>
-#include <iomanip>
 
 namespace plog
 {
@@ -15,39 +14,92 @@ namespace plog
 
         static util::nstring format(const Record& record)
         {
-            tm t;
-            util::localtime_s(&t, &record.getTime().time);
+            static thread_local util::SecondCache second;
 
-            util::nostringstream ss;
-            ss << t.tm_year + 1900 << PLOG_NSTR("/") << std::setfill(PLOG_NSTR('0')) << std::setw(2) << t.tm_mon + 1 << PLOG_NSTR("/") << std::setfill(PLOG_NSTR('0')) << std::setw(2) << t.tm_mday << PLOG_NSTR(";");
-            ss << std::setfill(PLOG_NSTR('0')) << std::setw(2) << t.tm_hour << PLOG_NSTR(":") << std::setfill(PLOG_NSTR('0')) << std::setw(2) << t.tm_min << PLOG_NSTR(":") << std::setfill(PLOG_NSTR('0')) << std::setw(2) << t.tm_sec << PLOG_NSTR(".") << std::setfill(PLOG_NSTR('0')) << std::setw(3) << record.getTime().millitm << PLOG_NSTR(";");
-            ss << severityToString(record.getSeverity()) << PLOG_NSTR(";");
-            ss << record.getTid() << PLOG_NSTR(";");
-            ss << record.getObject() << PLOG_NSTR(";");
-            ss << record.getFunc() << PLOG_NSTR("@") << record.getLine() << PLOG_NSTR(";");
+            util::nstring str;
+            str.reserve(96);
+            str.append(second.get(record.getTime(), layout));
+            str.push_back(PLOG_NSTR('.'));
+            util::appendNumber(str, util::nanoseconds(record.getTime()), 9);
+            str.push_back(PLOG_NSTR(';'));
+            util::appendNarrow(str, severityToString(record.getSeverity()));
+            str.push_back(PLOG_NSTR(';'));
+            util::appendNumber(str, record.getTid());
+            str.push_back(PLOG_NSTR(';'));
+            appendPointer(str, record.getObject());
+            str.push_back(PLOG_NSTR(';'));
+            util::appendNarrow(str, record.getFunc());
+            str.push_back(PLOG_NSTR('@'));
+            util::appendNumber(str, record.getLine());
+            str.push_back(PLOG_NSTR(';'));
 
-            util::nstring message = record.getMessage();
+            // Quoted, with every quote inside doubled.
+            const util::nchar* message = record.getMessage();
+            size_t size = 0;
+            str.push_back(PLOG_NSTR('"'));
 
-            if (message.size() > kMaxMessageSize)
+            for (; message[size] && size < kMaxMessageSize; ++size)
             {
-                message.resize(kMaxMessageSize);
-                message.append(PLOG_NSTR("..."));
-            }
+                if (message[size] == PLOG_NSTR('"'))
+                {
+                    str.push_back(PLOG_NSTR('"'));
+                }
 
-            util::nistringstream split(message);
-            util::nstring token;
+                str.push_back(message[size]);
+            }
 
-            while (!split.eof())
+            if (message[size])
             {
-                std::getline(split, token, PLOG_NSTR('"'));
-                ss << PLOG_NSTR("\"") << token << PLOG_NSTR("\"");
+                str.append(PLOG_NSTR("..."));
             }
 
-            ss << PLOG_NSTR("\n");
+            str.append(PLOG_NSTR("\"\n"));
 
-            return ss.str();
+            return str;
         }
 
         static const size_t kMaxMessageSize = 32000;
+
+    private:
+        // YYYY/MM/DD;HH:MM:SS
+        static void layout(util::nstring& str, const tm& t)
+        {
+            util::appendNumber(str, t.tm_year + 1900);
+            str.push_back(PLOG_NSTR('/'));
+            util::appendNumber(str, t.tm_mon + 1, 2);
+            str.push_back(PLOG_NSTR('/'));
+            util::appendNumber(str, t.tm_mday, 2);
+            str.push_back(PLOG_NSTR(';'));
+            util::appendNumber(str, t.tm_hour, 2);
+            str.push_back(PLOG_NSTR(':'));
+            util::appendNumber(str, t.tm_min, 2);
+            str.push_back(PLOG_NSTR(':'));
+            util::appendNumber(str, t.tm_sec, 2);
+        }
+
+        // As a stream prints it: 0x-prefixed hex, or 0.
+        static void appendPointer(util::nstring& str, const void* object)
+        {
+            unsigned long long value = reinterpret_cast<unsigned long long>(object);
+            if (!value)
+            {
+                str.push_back(PLOG_NSTR('0'));
+                return;
+            }
+
+            util::nchar digits[16];
+            size_t count = 0;
+
+            for (; value; value >>= 4)
+            {
+                digits[count++] = PLOG_NSTR("0123456789abcdef")[value & 0xf];
+            }
+
+            str.append(PLOG_NSTR("0x"));
+            while (count)
+            {
+                str.push_back(digits[--count]);
+            }
+        }
     };
 }
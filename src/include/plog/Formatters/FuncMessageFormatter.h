@@ -14,10 +14,15 @@ namespace plog
 
         static util::nstring format(const Record& record)
         {
-            util::nostringstream ss;
-            ss << record.getFunc() << PLOG_NSTR("@") << record.getLine() << PLOG_NSTR(": ") << record.getMessage() << PLOG_NSTR("\n");
+            util::nstring str;
+            util::appendNarrow(str, record.getFunc());
+            str.push_back(PLOG_NSTR('@'));
+            util::appendNumber(str, record.getLine());
+            str.append(PLOG_NSTR(": "));
+            str.append(record.getMessage());
+            str.push_back(PLOG_NSTR('\n'));
 
-            return ss.str();
+            return str;
         }
     };
 }
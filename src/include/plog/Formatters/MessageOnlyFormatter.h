@@ -14,10 +14,10 @@ namespace plog
 
         static util::nstring format(const Record& record)
         {
-            util::nostringstream ss;
-            ss << record.getMessage() << PLOG_NSTR("\n");
+            util::nstring str(record.getMessage());
+            str.push_back(PLOG_NSTR('\n'));
 
-            return ss.str();
+            return str;
         }
     };
 }
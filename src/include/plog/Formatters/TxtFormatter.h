@@ -1,7 +1,6 @@
 #pragma once
 #include <plog/Record.h>
 #include <plog/Util.h>
-#include <iomanip>
 
 namespace plog
 {
@@ -15,18 +14,54 @@ namespace plog
 
         static util::nstring format(const Record& record)
         {
-            tm t;
-            util::localtime_s(&t, &record.getTime().time);
-
-            util::nostringstream ss;
-            ss << t.tm_year + 1900 << "-" << std::setfill(PLOG_NSTR('0')) << std::setw(2) << t.tm_mon + 1 << PLOG_NSTR("-") << std::setfill(PLOG_NSTR('0')) << std::setw(2) << t.tm_mday << PLOG_NSTR(" ");
-            ss << std::setfill(PLOG_NSTR('0')) << std::setw(2) << t.tm_hour << PLOG_NSTR(":") << std::setfill(PLOG_NSTR('0')) << std::setw(2) << t.tm_min << PLOG_NSTR(":") << std::setfill(PLOG_NSTR('0')) << std::setw(2) << t.tm_sec << PLOG_NSTR(".") << std::setfill(PLOG_NSTR('0')) << std::setw(3) << record.getTime().millitm << PLOG_NSTR(" ");
-            ss << std::setfill(PLOG_NSTR(' ')) << std::setw(5) << std::left << severityToString(record.getSeverity()) << PLOG_NSTR(" ");
-            ss << PLOG_NSTR("[") << record.getTid() << PLOG_NSTR("] ");
-            ss << PLOG_NSTR("[") << record.getFunc() << PLOG_NSTR("@") << record.getLine() << PLOG_NSTR("] ");
-            ss << record.getMessage() << PLOG_NSTR("\n");
-
-            return ss.str();
+            static thread_local util::SecondCache second;
+
+            const util::nchar* message = record.getMessage();
+            const util::nstring& date = second.get(record.getTime(), layout);
+
+            // Date, time and the other fields take well under 96 characters.
+            util::nstring str;
+            str.reserve(date.size() + std::char_traits<util::nchar>::length(message) + 96);
+            str.append(date);
+            str.push_back(PLOG_NSTR('.'));
+            util::appendNumber(str, util::nanoseconds(record.getTime()), 9);
+            str.push_back(PLOG_NSTR(' '));
+
+            const char* severity = severityToString(record.getSeverity());
+            util::appendNarrow(str, severity);
+            for (size_t i = std::strlen(severity); i < 5; ++i)
+            {
+                str.push_back(PLOG_NSTR(' '));
+            }
+
+            str.append(PLOG_NSTR(" ["));
+            util::appendNumber(str, record.getTid());
+            str.append(PLOG_NSTR("] ["));
+            util::appendNarrow(str, record.getFunc());
+            str.push_back(PLOG_NSTR('@'));
+            util::appendNumber(str, record.getLine());
+            str.append(PLOG_NSTR("] "));
+            str.append(message);
+            str.push_back(PLOG_NSTR('\n'));
+
+            return str;
+        }
+
+    private:
+        // YYYY-MM-DD HH:MM:SS
+        static void layout(util::nstring& str, const tm& t)
+        {
+            util::appendNumber(str, t.tm_year + 1900);
+            str.push_back(PLOG_NSTR('-'));
+            util::appendNumber(str, t.tm_mon + 1, 2);
+            str.push_back(PLOG_NSTR('-'));
+            util::appendNumber(str, t.tm_mday, 2);
+            str.push_back(PLOG_NSTR(' '));
+            util::appendNumber(str, t.tm_hour, 2);
+            str.push_back(PLOG_NSTR(':'));
+            util::appendNumber(str, t.tm_min, 2);
+            str.push_back(PLOG_NSTR(':'));
+            util::appendNumber(str, t.tm_sec, 2);
         }
     };
 }
@@ -30,10 +30,33 @@
 #   define PLOG_GET_FILE()      ""
 #endif
 
+//////////////////////////////////////////////////////////////////////////
+// Compile-time severity ceiling: records more verbose than
+// PLOG_MAX_SEVERITY (a plog::Severity or its number) are compiled out,
+// whatever the logger's runtime severity is.
+
+#ifndef PLOG_MAX_SEVERITY
+#   define PLOG_MAX_SEVERITY            plog::verbose
+#endif
+
+namespace plog
+{
+    const Severity kMaxSeverity = static_cast<Severity>(PLOG_MAX_SEVERITY);
+
+    inline constexpr bool isCompiledIn(Severity severity)
+    {
+        return severity <= kMaxSeverity;
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////
 // Log severity level checker
 
-#define IF_LOG_(instance, severity)     if (!plog::get<instance>() || !plog::get<instance>()->checkSeverity(severity)) {;} else
+// The ceiling is compared inline rather than through isCompiledIn(): for a
+// constant severity the compiler folds the comparison even without
+// optimization, so the logger lookup and the whole Record expression are
+// dropped. A runtime severity is simply checked twice.
+#define IF_LOG_(instance, severity)     if (!((severity) <= plog::kMaxSeverity) || !plog::get<instance>() || !plog::get<instance>()->checkSeverity(severity)) {;} else
 #define IF_LOG(severity)                IF_LOG_(PLOG_DEFAULT_INSTANCE, severity)
 
 //////////////////////////////////////////////////////////////////////////
@@ -1,6 +1,7 @@
 #pragma once
 #include <plog/Severity.h>
 #include <plog/Util.h>
+#include <vector>
 
 #ifdef __cplusplus_cli
 #include <vcclr.h>  // For PtrToStringChars
@@ -13,7 +14,7 @@ namespace plog
         //////////////////////////////////////////////////////////////////////////
         // Stream output operators as free functions
 
-        inline void operator<<(util::nostringstream& stream, const char* data)
+        inline void operator<<(util::nostream& stream, const char* data)
         {
             data = data ? data : "(null)";
 
@@ -26,13 +27,13 @@ namespace plog
 #endif
         }
 
-        inline void operator<<(util::nostringstream& stream, const std::string& data)
+        inline void operator<<(util::nostream& stream, const std::string& data)
         {
             plog::detail::operator<<(stream, data.c_str());
         }
 
 #if PLOG_ENABLE_WCHAR_INPUT
-        inline void operator<<(util::nostringstream& stream, const wchar_t* data)
+        inline void operator<<(util::nostream& stream, const wchar_t* data)
         {
             data = data ? data : L"(null)";
 
@@ -43,7 +44,7 @@ namespace plog
 #   endif
         }
 
-        inline void operator<<(util::nostringstream& stream, const std::wstring& data)
+        inline void operator<<(util::nostream& stream, const std::wstring& data)
         {
             plog::detail::operator<<(stream, data.c_str());
         }
@@ -90,7 +91,7 @@ namespace plog
         }
 
         template<class T>
-        inline typename meta::enableIf<meta::isStreamable<T, std::ostream>::value && !meta::isStreamable<T, std::wostream>::value, void>::type operator<<(std::wostringstream& stream, const T& data)
+        inline typename meta::enableIf<meta::isStreamable<T, std::ostream>::value && !meta::isStreamable<T, std::wostream>::value, void>::type operator<<(std::wostream& stream, const T& data)
         {
             std::ostringstream ss;
             ss << data;
@@ -99,6 +100,75 @@ namespace plog
 #endif
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    // A named value carried beside the message, for appenders that store
+    // structured data (JournaldAppender). Formatters that only print text
+    // leave fields out. The key must outlive the record, which a string
+    // literal does; journald wants it in upper case letters, digits and '_'.
+
+    struct Field
+    {
+        const char* key;
+        std::string value;
+    };
+
+    inline Field field(const char* key, const std::string& value)
+    {
+        Field f = { key, value };
+        return f;
+    }
+
+    inline Field field(const char* key, const char* value)
+    {
+        Field f = { key, value ? value : "(null)" };
+        return f;
+    }
+
+    inline Field field(const char* key, int value)
+    {
+        Field f = { key, std::to_string(value) };
+        return f;
+    }
+
+    inline Field field(const char* key, unsigned int value)
+    {
+        Field f = { key, std::to_string(value) };
+        return f;
+    }
+
+    inline Field field(const char* key, long value)
+    {
+        Field f = { key, std::to_string(value) };
+        return f;
+    }
+
+    inline Field field(const char* key, unsigned long value)
+    {
+        Field f = { key, std::to_string(value) };
+        return f;
+    }
+
+    inline Field field(const char* key, long long value)
+    {
+        Field f = { key, std::to_string(value) };
+        return f;
+    }
+
+    inline Field field(const char* key, unsigned long long value)
+    {
+        Field f = { key, std::to_string(value) };
+        return f;
+    }
+
+    inline Field field(const char* key, double value)
+    {
+        // Same as a stream prints it.
+        char str[32];
+        snprintf(str, sizeof(str), "%g", value);
+        Field f = { key, str };
+        return f;
+    }
+
     class Record
     {
     public:
@@ -154,6 +224,12 @@ namespace plog
         }
 #endif
 
+        Record& operator<<(const Field& data)
+        {
+            m_fields.push_back(data);
+            return *this;
+        }
+
         template<typename T>
         Record& operator<<(const T& data)
         {
@@ -193,8 +269,7 @@ namespace plog
 
         virtual const util::nchar* getMessage() const
         {
-            m_messageStr = m_message.str();
-            return m_messageStr.c_str();
+            return m_message.c_str();
         }
 
         virtual const char* getFunc() const
@@ -208,6 +283,11 @@ namespace plog
             return m_file;
         }
 
+        virtual const std::vector<Field>& getFields() const
+        {
+            return m_fields;
+        }
+
         virtual ~Record() // virtual destructor to satisfy -Wnon-virtual-dtor warning
         {
         }
@@ -218,10 +298,52 @@ namespace plog
         const unsigned int      m_tid;
         const void* const       m_object;
         const size_t            m_line;
-        util::nostringstream    m_message;
+        mutable util::MessageStream m_message;
         const char* const       m_func;
         const char* const       m_file;
         mutable std::string     m_funcStr;
-        mutable util::nstring   m_messageStr;
+        std::vector<Field>      m_fields;
     };
+
+    namespace detail
+    {
+        // A record rebuilt from parts stored elsewhere (an async queue slot,
+        // an entry of a binary log), to hand to an appender or formatter.
+        // It only refers to the parts, which must outlive it.
+        class StoredRecord : public Record
+        {
+        public:
+            StoredRecord(Severity severity, const char* func, size_t line, const char* file, const void* object,
+                const util::Time& time, unsigned int tid, const util::nstring& message, const std::vector<Field>& fields)
+                : Record(severity, func, line, file, object), m_storedTime(time), m_storedTid(tid), m_storedMessage(message), m_storedFields(fields)
+            {
+            }
+
+            virtual const util::Time& getTime() const
+            {
+                return m_storedTime;
+            }
+
+            virtual unsigned int getTid() const
+            {
+                return m_storedTid;
+            }
+
+            virtual const util::nchar* getMessage() const
+            {
+                return m_storedMessage.c_str();
+            }
+
+            virtual const std::vector<Field>& getFields() const
+            {
+                return m_storedFields;
+            }
+
+        private:
+            const util::Time&       m_storedTime;
+            const unsigned int      m_storedTid;
+            const util::nstring&    m_storedMessage;
+            const std::vector<Field>& m_storedFields;
+        };
+    }
 }
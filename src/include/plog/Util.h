@@ -30,12 +30,29 @@
 #   include <unistd.h>
 #   include <sys/syscall.h>
 #   include <sys/time.h>
+#   include <time.h>
 #   include <pthread.h>
 #   if PLOG_ENABLE_WCHAR_INPUT
 #       include <iconv.h>
 #   endif
 #endif
 
+// Record timestamps come from this clock. PLOG_COARSE_CLOCK trades
+// resolution (a few milliseconds) for a cheaper read where the system has
+// a coarse clock.
+#ifndef PLOG_CLOCK
+#   if defined(PLOG_COARSE_CLOCK) && defined(CLOCK_REALTIME_COARSE)
+#       define PLOG_CLOCK CLOCK_REALTIME_COARSE
+#   else
+#       define PLOG_CLOCK CLOCK_REALTIME
+#   endif
+#endif
+
+// Messages up to this many characters are built inside the Record.
+#ifndef PLOG_MESSAGE_INLINE_SIZE
+#   define PLOG_MESSAGE_INLINE_SIZE 256
+#endif
+
 #ifdef _WIN32
 #   define _PLOG_NSTR(x)   L##x
 #   define PLOG_NSTR(x)    _PLOG_NSTR(x)
@@ -49,11 +66,13 @@ namespace plog
     {
 #ifdef _WIN32
         typedef std::wstring nstring;
+        typedef std::wostream nostream;
         typedef std::wostringstream nostringstream;
         typedef std::wistringstream nistringstream;
         typedef wchar_t nchar;
 #else
         typedef std::string nstring;
+        typedef std::ostream nostream;
         typedef std::ostringstream nostringstream;
         typedef std::istringstream nistringstream;
         typedef char nchar;
@@ -79,24 +98,36 @@ namespace plog
         {
             ::ftime(t);
         }
+
+        inline unsigned long nanoseconds(const Time& t)
+        {
+            return t.millitm * 1000000UL;
+        }
 #else
         struct Time
         {
             time_t time;
             unsigned short millitm;
+            unsigned int nanotm; // nanoseconds within the second
         };
 
         inline void ftime(Time* t)
         {
-            timeval tv;
-            ::gettimeofday(&tv, NULL);
+            timespec ts;
+            ::clock_gettime(PLOG_CLOCK, &ts);
+
+            t->time = ts.tv_sec;
+            t->millitm = static_cast<unsigned short>(ts.tv_nsec / 1000000);
+            t->nanotm = static_cast<unsigned int>(ts.tv_nsec);
+        }
 
-            t->time = tv.tv_sec;
-            t->millitm = static_cast<unsigned short>(tv.tv_usec / 1000);
+        inline unsigned long nanoseconds(const Time& t)
+        {
+            return t.nanotm;
         }
 #endif
 
-        inline unsigned int gettid()
+        inline unsigned int gettidUncached()
         {
 #ifdef _WIN32
             return GetCurrentThreadId();
@@ -115,6 +146,14 @@ namespace plog
 #endif
         }
 
+        // Asked once per thread. A child forked by a logging thread keeps
+        // its parent's value until it execs.
+        inline unsigned int gettid()
+        {
+            static thread_local const unsigned int tid = gettidUncached();
+            return tid;
+        }
+
 #if PLOG_ENABLE_WCHAR_INPUT && !defined(_WIN32)
         inline std::string toNarrow(const wchar_t* wstr)
         {
@@ -219,6 +258,142 @@ namespace plog
             }
         }
 
+        // Appends value in decimal, zero-padded to at least width digits.
+        inline void appendNumber(nstring& str, unsigned long value, size_t width = 0)
+        {
+            nchar digits[24];
+            size_t count = 0;
+
+            do
+            {
+                digits[count++] = static_cast<nchar>('0' + value % 10);
+                value /= 10;
+            } while (value);
+
+            while (count < width && count < sizeof(digits) / sizeof(digits[0]))
+            {
+                digits[count++] = '0';
+            }
+
+            while (count)
+            {
+                str.push_back(digits[--count]);
+            }
+        }
+
+        // Appends a narrow string, widened if need be.
+        inline void appendNarrow(nstring& str, const char* data)
+        {
+            while (*data)
+            {
+                str.push_back(static_cast<nchar>(static_cast<unsigned char>(*data++)));
+            }
+        }
+
+        // The local date and time of one second as a formatter lays it out,
+        // so records within the same second skip localtime and formatting.
+        // Formatters keep one per thread.
+        struct SecondCache
+        {
+            time_t  second;
+            nstring text;
+
+            SecondCache() : second(-1)
+            {
+            }
+
+            // Runs layout(text, tm) only when t is in another second.
+            template<class Layout>
+            const nstring& get(const Time& t, Layout layout)
+            {
+                if (t.time != second)
+                {
+                    tm local;
+                    localtime_s(&local, &t.time);
+                    text.clear();
+                    layout(text, local);
+                    second = t.time;
+                }
+
+                return text;
+            }
+        };
+
+        //////////////////////////////////////////////////////////////////////////
+        // Output stream over a buffer inside the object: messages that fit
+        // never touch the heap, longer ones move there as they grow.
+
+        class MessageBuf : public std::basic_streambuf<nchar>
+        {
+        public:
+            MessageBuf()
+            {
+                reset();
+            }
+
+            // The message so far, NUL-terminated.
+            const nchar* c_str()
+            {
+                if (m_overflow.empty())
+                {
+                    *pptr() = 0;
+                    return m_inline;
+                }
+
+                spill();
+                return m_overflow.c_str();
+            }
+
+        protected:
+            virtual int_type overflow(int_type c)
+            {
+                spill();
+
+                if (!traits_type::eq_int_type(c, traits_type::eof()))
+                {
+                    m_overflow.push_back(traits_type::to_char_type(c));
+                }
+
+                return traits_type::not_eof(c);
+            }
+
+        private:
+            void reset()
+            {
+                // One character is kept back for the terminator.
+                setp(m_inline, m_inline + PLOG_MESSAGE_INLINE_SIZE - 1);
+            }
+
+            // Moves what is in the inline buffer behind the overflow and
+            // starts filling the inline buffer again.
+            void spill()
+            {
+                m_overflow.append(pbase(), pptr());
+                reset();
+            }
+
+        private:
+            nchar   m_inline[PLOG_MESSAGE_INLINE_SIZE];
+            nstring m_overflow;
+        };
+
+        class MessageStream : public nostream
+        {
+        public:
+            MessageStream() : nostream(NULL)
+            {
+                rdbuf(&m_buf);
+            }
+
+            const nchar* c_str()
+            {
+                return m_buf.c_str();
+            }
+
+        private:
+            MessageBuf m_buf;
+        };
+
         class NonCopyable
         {
         protected:
@@ -275,6 +450,18 @@ namespace plog
                 return write(str.data(), str.size() * sizeof(CharType));
             }
 
+            // Waits until what was written is on disk.
+            int sync()
+            {
+#ifdef _WIN32
+                return m_file != -1 ? ::_commit(m_file) : -1;
+#elif defined(__linux__)
+                return m_file != -1 ? ::fdatasync(m_file) : -1;
+#else
+                return m_file != -1 ? ::fsync(m_file) : -1;
+#endif
+            }
+
             off_t seek(off_t offset, int whence)
             {
 #ifdef _WIN32
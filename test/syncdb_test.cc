@@ -0,0 +1,123 @@
+/* Reads the fixture databases in data/ and checks what comes out: the repo
+ * list of a pacman.conf that pulls a repo in through Include, and the
+ * name/version table of a gzip and a zstd sync database. The exact*.db
+ * pair decompresses to exactly two READ_CHUNKs, pkg000 1.0-1 to pkg169
+ * 1.169-1, so their last output chunk comes out with no input left.
+ *
+ * Usage: aarchup_syncdb_test [data dir]
+ *
+ * Exits non-zero and names the failed checks if anything is off. */
+#include <stdio.h>
+#include <unistd.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "PackageTable.hh"
+#include "PacmanConf.hh"
+#include "SyncDb.hh"
+
+using namespace std;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    if (!(cond)) {                                                    \
+      cerr << __FILE__ << ":" << __LINE__ << ": " << #cond << "\n"; \
+      ++failures;                                                     \
+    }                                                                 \
+  } while (0)
+
+typedef vector<pair<string, string>> Packages;
+
+static Packages tableOf(const PackageTable &table) {
+  Packages packages;
+  for (size_t i = 0; i < table.size(); ++i) {
+    packages.emplace_back(string(table.name(i)), string(table.version(i)));
+  }
+  return packages;
+}
+
+static void testPacmanConf() {
+  const PacmanConf conf = PacmanConf::load("pacman.conf");
+  CHECK(conf.dbPath == "/nonexistent/");
+  CHECK((conf.repos == vector<string>{"core", "extra"}));
+}
+
+static void testGzip() {
+  PackageTable table;
+  SyncDb::load("sync/core.db", table);
+  const Packages expected = {{"glibc", "2.40+r16+gaa533d58ff-2"},
+                             {"linux", "6.10.1.arch1-1"},
+                             {"pacman", "7.0.0.r3.g7736133-1"},
+                             {"zlib", "1:1.3.1-2"}};
+  CHECK(tableOf(table) == expected);
+  CHECK(table.find("pacman") == 2);
+  CHECK(table.find("missing") == table.size());
+}
+
+static void testZstd() {
+  PackageTable table;
+#ifdef AARCHUP_HAVE_ZSTD
+  SyncDb::load("sync/extra.db", table);
+  const Packages expected = {{"firefox", "130.0-1"},
+                             {"python-zstandard", "0.23.0-1"},
+                             {"vim", "9.1.0707-1"}};
+  CHECK(tableOf(table) == expected);
+#else
+  /* Without libzstd the database must be refused, not misread. */
+  bool threw = false;
+  try {
+    SyncDb::load("sync/extra.db", table);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  CHECK(threw);
+#endif
+}
+
+/* pkg000 1.0-1 to pkg169 1.169-1. */
+static Packages exactPackages() {
+  Packages packages;
+  for (int i = 0; i < 170; ++i) {
+    char name[16];
+    snprintf(name, sizeof(name), "pkg%03d", i);
+    packages.emplace_back(name, "1." + to_string(i) + "-1");
+  }
+  return packages;
+}
+
+static void testExactChunks() {
+  PackageTable table;
+  SyncDb::load("sync/exact.db", table);
+  CHECK(tableOf(table) == exactPackages());
+#ifdef AARCHUP_HAVE_ZSTD
+  PackageTable zstdTable;
+  SyncDb::load("sync/exact-zstd.db", zstdTable);
+  CHECK(tableOf(zstdTable) == exactPackages());
+#endif
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && chdir(argv[1]) != 0) {
+    cerr << "Can't enter " << argv[1] << "\n";
+    return 2;
+  }
+  try {
+    testPacmanConf();
+    testGzip();
+    testZstd();
+    testExactChunks();
+  } catch (const std::exception &e) {
+    cerr << "Unexpected exception: " << e.what() << "\n";
+    return 1;
+  }
+  if (failures) {
+    cerr << failures << " check(s) failed\n";
+    return 1;
+  }
+  return 0;
+}